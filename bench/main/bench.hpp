@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdio>
+#include "stusb4500.hpp"
+#include "stusb4500_emulator.hpp"
+
+namespace stusb4500::bench {
+
+/**
+ * @brief Exécute fn sur la tâche courante et affiche le coût bus mesuré par l'émulateur.
+ */
+template <typename Fn>
+emu::Counters measure(emu::Emulator& chip, const char* name, Fn&& fn)
+{
+    chip.begin_capture();
+    fn();
+    emu::Counters c = chip.end_capture();
+    printf("%-32s %6lu %7lu %6lu %6lu %10.2f\n", name,
+           (unsigned long)c.transactions, (unsigned long)c.bytes,
+           (unsigned long)c.erased_sectors, (unsigned long)c.programmed_sectors,
+           c.modeled_us / 1000.0);
+    return c;
+}
+
+inline void print_header(const char* title)
+{
+    printf("\n=== %s ===\n", title);
+    printf("%-32s %6s %7s %6s %6s %10s\n", "operation", "tx", "bytes", "erase", "prog", "time_ms");
+}
+
+// Allocations (operator new) effectuées par la tâche courante depuis son démarrage
+uint64_t alloc_count();
+
+// === Suites ===
+void run_api_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_config_bench(emu::Emulator& chip, STUSB4500& dev);
+void print_ftp_stats(STUSB4500& dev);
+void run_fields_bench();
+void run_micro_bench();
+void run_bus_bench();
+void run_command_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_policy_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_reneg_bench(emu::Emulator& chip, STUSB4500& dev, int cycles);
+void run_profile_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_store_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_verify_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_guard_bench(emu::Emulator& chip, STUSB4500& dev);
+void run_detect_bench(uint32_t power_on_ms);
+void run_events_bench();
+void run_manager_bench(size_t count);
+
+} // namespace stusb4500::bench
@@ -0,0 +1,30 @@
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Compteur d'allocations par tâche : seules celles de la tâche mesurée comptent
+namespace
+{
+    thread_local uint64_t allocations = 0;
+
+    void *counted_alloc(size_t size)
+    {
+        allocations++;
+        if (void *p = std::malloc(size ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace stusb4500::bench
+{
+    uint64_t alloc_count() { return allocations; }
+}
@@ -0,0 +1,141 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include <cstring>
+
+namespace stusb4500::bench
+{
+    void run_api_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        print_header("Coût bus par appel public");
+
+        // Chaque mesure repart de l'image NVM par défaut, relue par le driver
+        auto run = [&](const char *name, auto &&fn)
+        {
+            chip.load_nvm(default_sector_config);
+            dev.read_sectors();
+            measure(chip, name, fn);
+        };
+
+        uint8_t one_byte_changed[5][8];
+        memcpy(one_byte_changed, default_sector_config, sizeof(one_byte_changed));
+        one_byte_changed[1][0] ^= 0x10;
+
+        uint32_t pdo = 0;
+        run("read()", [&] { dev.read(); });
+        run("read_sectors()", [&] { dev.read_sectors(); });
+        run("write_sectors()", [&] { dev.write_sectors(); });
+        run("write_default_sectors() =", [&] { dev.write_default_sectors(default_sector_config); });
+        run("write_default_sectors() 1 octet", [&] { dev.write_default_sectors(one_byte_changed); });
+        run("program_sectors() 5 secteurs", [&] { dev.program_sectors(one_byte_changed, 0x1F); });
+        run("enter_write_mode(S1)+exit", [&]
+            {
+                dev.enter_write_mode(SECTOR_1);
+                dev.exit_test_mode();
+            });
+        run("write_sector(1)", [&] { dev.write_sector(1, one_byte_changed[1]); });
+        run("sync_volatile()", [&] { dev.sync_volatile(); });
+        run("read_pdo(2)", [&] { dev.read_pdo(2, pdo); });
+        run("write_pdo(2)", [&] { dev.write_pdo(2, pdo); });
+        uint32_t table[3] = {};
+        run("read_pdos()", [&] { dev.read_pdos(table); });
+        run("3 x write_pdo()", [&]
+            {
+                for (uint8_t i = 1; i <= 3; ++i)
+                    dev.write_pdo(i, table[i - 1]);
+            });
+        run("write_pdos() 3 PDO", [&] { dev.write_pdos(table); });
+        run("soft_reset()", [&] { dev.soft_reset(); });
+        run("get_pdo_number()", [&] { dev.get_pdo_number(); });
+        run("set_voltage(2, 9 V)", [&] { dev.set_voltage(2, 9.0f); });
+        run("set_current(2, 2 A)", [&] { dev.set_current(2, 2.0f); });
+        run("set_pdo_number(3)", [&] { dev.set_pdo_number(3); });
+        run("3 x set_voltage+set_current", [&]
+            {
+                for (uint8_t i = 1; i <= 3; ++i)
+                {
+                    dev.set_voltage(i, 9.0f);
+                    dev.set_current(i, 1.5f);
+                }
+            });
+        run("set_upper_voltage_limit(1, 10)", [&] { dev.set_upper_voltage_limit(1, 10); });
+        run("set_lower_voltage_limit(2, 10)", [&] { dev.set_lower_voltage_limit(2, 10); });
+        run("set_flex_current(1.5 A)", [&] { dev.set_flex_current(1.5f); });
+        run("set_external_power(1)", [&] { dev.set_external_power(1); });
+        run("set_usb_comm_capable(1)", [&] { dev.set_usb_comm_capable(1); });
+        run("set_config_ok_gpio(2)", [&] { dev.set_config_ok_gpio(2); });
+        run("set_gpio_ctrl(1)", [&] { dev.set_gpio_ctrl(1); });
+        run("set_power_above_5v_only(1)", [&] { dev.set_power_above_5v_only(1); });
+        run("set_req_src_current(1)", [&] { dev.set_req_src_current(1); });
+    }
+
+    void run_config_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        print_header("Six champs NVM : mutateurs vs transaction");
+
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        measure(chip, "6 x set_*", [&]
+                {
+                    dev.set_upper_voltage_limit(1, 10);
+                    dev.set_lower_voltage_limit(2, 10);
+                    dev.set_flex_current(1.5f);
+                    dev.set_gpio_ctrl(1);
+                    dev.set_power_above_5v_only(1);
+                    dev.set_req_src_current(1);
+                });
+
+        CommitReport report;
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        measure(chip, "begin_config() ... commit()", [&]
+                {
+                    dev.begin_config()
+                        .set_upper_voltage_limit(1, 10)
+                        .set_lower_voltage_limit(2, 10)
+                        .set_flex_current(1.5f)
+                        .set_gpio_ctrl(1)
+                        .set_power_above_5v_only(1)
+                        .set_req_src_current(1)
+                        .commit(&report);
+                });
+
+        printf("commit: %u champs, %u secteurs, %lu tx, économie estimée %lu tx / %lu us\n",
+               report.edits, report.sectors, (unsigned long)report.transactions,
+               (unsigned long)report.saved_transactions, (unsigned long)report.saved_us);
+    }
+
+    void print_ftp_stats(STUSB4500 &dev)
+    {
+        static const struct
+        {
+            uint8_t opcode;
+            const char *name;
+        } ops[] = {
+            {READ, "READ"},
+            {WRITE_PL, "WRITE_PL"},
+            {WRITE_SER, "WRITE_SER"},
+            {SOFT_PROG_SECTOR, "SOFT_PROG_SECTOR"},
+            {ERASE_SECTOR, "ERASE_SECTOR"},
+            {PROG_SECTOR, "PROG_SECTOR"},
+        };
+
+        printf("\n=== Latences FTP (us) ===\n");
+        printf("%-18s %6s %6s %8s %8s %8s %8s %8s\n", "opcode", "count", "tmo", "polls", "min", "avg", "max", "expect");
+        for (const auto &op : ops)
+        {
+            FtpStats st = dev.get_ftp_stats(op.opcode);
+            if (st.count == 0)
+                continue;
+            printf("%-18s %6lu %6lu %8lu %8lu %8lu %8lu %8lu\n", op.name,
+                   (unsigned long)st.count, (unsigned long)st.timeouts, (unsigned long)st.polls,
+                   (unsigned long)st.min_us, (unsigned long)(st.total_us / st.count),
+                   (unsigned long)st.max_us, (unsigned long)st.expected_us);
+            printf("%-18s", "");
+            for (int k = 0; k < FtpStats::Buckets; ++k)
+                if (st.histogram[k])
+                    printf(" [%lu..%lu[:%lu", k ? 1ul << k : 0ul, 2ul << k, (unsigned long)st.histogram[k]);
+            printf("\n");
+        }
+    }
+}
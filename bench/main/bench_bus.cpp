@@ -0,0 +1,101 @@
+#include "bench.hpp"
+#include "stusb4500_bus.hpp"
+#include "stusb4500_conf.hpp"
+
+#include <cstring>
+#include "esp_timer.h"
+
+namespace
+{
+    using namespace stusb4500;
+
+    // Modèle minimal de la machine FTP : REQ retombe immédiatement, READ copie le secteur
+    struct RegisterFile
+    {
+        uint8_t regs[256] = {};
+        uint8_t nvm[5][8] = {};
+
+        esp_err_t read(uint8_t reg, uint8_t *data, size_t len)
+        {
+            memcpy(data, &regs[reg], len);
+            return ESP_OK;
+        }
+
+        esp_err_t write(uint8_t reg, const uint8_t *data, size_t len)
+        {
+            memcpy(&regs[reg], data, len);
+            if (reg <= FTP_CTRL_0 && reg + len > FTP_CTRL_0 && (regs[FTP_CTRL_0] & FTP_CUST_REQ))
+            {
+                uint8_t sect = regs[FTP_CTRL_0] & FTP_CUST_SECT;
+                if ((regs[FTP_CTRL_1] & FTP_CUST_OPCODE) == READ && sect < 5)
+                    memcpy(&regs[RW_BUFFER], nvm[sect], 8);
+                regs[FTP_CTRL_0] &= ~FTP_CUST_REQ;
+            }
+            return ESP_OK;
+        }
+    };
+
+    // Même registre derrière l'interface virtuelle historique
+    class RegisterFileDevice : public I2CDevice
+    {
+    public:
+        RegisterFile file;
+        esp_err_t read(uint8_t reg, uint8_t *data, size_t len) override { return file.read(reg, data, len); }
+        esp_err_t write(uint8_t reg, const uint8_t *data, size_t len) override { return file.write(reg, data, len); }
+    };
+
+    struct RegisterFileBus
+    {
+        RegisterFile *file;
+        esp_err_t read(uint8_t reg, uint8_t *data, size_t len) { return file->read(reg, data, len); }
+        esp_err_t write(uint8_t reg, const uint8_t *data, size_t len) { return file->write(reg, data, len); }
+    };
+
+    // Une instanciation par politique, hors ligne pour comparer le code généré (nm --size-sort)
+    __attribute__((noinline)) esp_err_t read_nvm_virtual(FtpEngine<I2CDeviceBus> &ftp, uint8_t image[5][8])
+    {
+        return ftp.read_sectors(image);
+    }
+
+    __attribute__((noinline)) esp_err_t read_nvm_static(FtpEngine<RegisterFileBus> &ftp, uint8_t image[5][8])
+    {
+        return ftp.read_sectors(image);
+    }
+
+    constexpr int Iterations = 200000;
+
+    template <typename Fn>
+    double ns_per_op(Fn &&fn)
+    {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < Iterations; ++i)
+            fn();
+        return (esp_timer_get_time() - start) * 1000.0 / Iterations;
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_bus_bench()
+    {
+        // Le shared_ptr n'est qu'un propriétaire : le moteur garde un pointeur brut
+        std::shared_ptr<I2CDevice> device = std::make_shared<RegisterFileDevice>();
+        RegisterFile &backing = static_cast<RegisterFileDevice &>(*device).file;
+        memcpy(backing.nvm, default_sector_config, sizeof(backing.nvm));
+        RegisterFile direct = backing;
+
+        FtpEngine<I2CDeviceBus> virtual_ftp{I2CDeviceBus{device.get()}};
+        FtpEngine<RegisterFileBus> static_ftp{RegisterFileBus{&direct}};
+
+        uint8_t a[5][8] = {}, b[5][8] = {};
+        read_nvm_virtual(virtual_ftp, a);
+        read_nvm_static(static_ftp, b);
+
+        printf("\n=== Politique de bus : lecture NVM complète (5 secteurs, 23 accès) ===\n");
+        printf("résultats identiques : %s\n",
+               memcmp(a, b, sizeof(a)) == 0 && memcmp(a, default_sector_config, sizeof(a)) == 0 ? "oui" : "NON");
+        printf("%-32s %10s\n", "politique", "ns/op");
+        printf("%-32s %10.1f\n", "I2CDeviceBus (virtuel)", ns_per_op([&] { read_nvm_virtual(virtual_ftp, a); }));
+        printf("%-32s %10.1f\n", "RegisterFileBus (statique)", ns_per_op([&] { read_nvm_static(static_ftp, b); }));
+    }
+}
@@ -0,0 +1,51 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include "esp_timer.h"
+
+namespace stusb4500::bench
+{
+    void run_command_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        printf("\n=== File de commandes : temps bloquant côté appelant ===\n");
+        printf("%-32s %10s %10s %6s\n", "opération", "appel_us", "fin_us", "tx");
+
+        auto report = [&](const char *name, int64_t start, int64_t returned, uint32_t tx)
+        {
+            printf("%-32s %10lld %10lld %6lu\n", name, (long long)(returned - start),
+                   (long long)(esp_timer_get_time() - start), (unsigned long)tx);
+        };
+
+        // Synchrone : l'appelant attend mot de passe, effacement et programmation
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        uint32_t tx0 = chip.counters().transactions;
+        int64_t start = esp_timer_get_time();
+        dev.set_gpio_ctrl(1);
+        dev.set_flex_current(1.5f);
+        dev.set_upper_voltage_limit(1, 10);
+        dev.set_flex_current(2.0f);
+        report("4 x set_* synchrones", start, esp_timer_get_time(), chip.counters().transactions - tx0);
+
+        // Asynchrone : soumission immédiate, exécution par la tâche du driver
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        CommandStats before = dev.get_command_stats();
+        tx0 = chip.counters().transactions;
+        start = esp_timer_get_time();
+        dev.submit(Command::set_gpio_ctrl(1));
+        dev.submit(Command::set_flex_current(1.5f));
+        dev.submit(Command::set_upper_voltage_limit(1, 10));
+        auto last = dev.submit(Command::set_flex_current(2.0f)); // remplace 1,5 A encore en file
+        int64_t returned = esp_timer_get_time();
+        CommandResult result = last ? dev.wait(*last, pdMS_TO_TICKS(1000)) : std::unexpected(last.error());
+        report("4 x submit() + wait()", start, returned, chip.counters().transactions - tx0);
+
+        CommandStats after = dev.get_command_stats();
+        printf("résultat : %s ; fusionnées %lu, exécutions %lu, commits NVM %lu ; flex %.2f A\n",
+               result ? "OK" : esp_err_to_name(result.error()),
+               (unsigned long)(after.merged - before.merged),
+               (unsigned long)(after.executed - before.executed),
+               (unsigned long)(after.nvm_commits - before.nvm_commits), dev.get_flex_current());
+    }
+}
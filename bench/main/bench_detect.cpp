@@ -0,0 +1,58 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace stusb4500::bench
+{
+    void run_detect_bench(uint32_t power_on_ms)
+    {
+        printf("\n=== Détection : puce alimentée %lu ms après le driver ===\n", (unsigned long)power_on_ms);
+        printf("%-28s %12s %8s %14s %12s\n", "mode", "détection_ms", "pings", "1re_sync_ms", "prêt_us");
+
+        struct
+        {
+            const char *name;
+            DetectConfig config;
+            bool alert;
+        } modes[] = {
+            {"fixe 10 s (historique)", {10000, 10000, false}, false},
+            {"recul 10 ms -> 10 s", {}, false},
+            {"recul + front ALERT", {}, true},
+        };
+
+        // Instances conservées jusqu'à la fin du banc, avec leur tâche de synchronisation
+        static std::shared_ptr<emu::Emulator> chips[3];
+        static std::unique_ptr<STUSB4500> devs[3];
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const auto &mode = modes[i];
+            auto chip = chips[i] = std::make_shared<emu::Emulator>();
+            chip->load_nvm(default_sector_config);
+            chip->set_online(false);
+
+            devs[i] = std::make_unique<STUSB4500>(chip);
+            STUSB4500 &dev = *devs[i];
+            dev.set_detect_config(mode.config);
+            if (mode.alert)
+            {
+                chip->set_alert_callback([&dev] { STUSB4500::alert_isr_handler(&dev); });
+                dev.configure_alert_pin(GPIO_NUM_25);
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(power_on_ms));
+            int64_t powered = esp_timer_get_time();
+            chip->set_online(true);
+            esp_err_t err = dev.wait_until_ready(pdMS_TO_TICKS(15000));
+            int64_t ready = esp_timer_get_time();
+
+            DetectStats st = dev.get_detect_stats();
+            printf("%-28s %12.1f %8lu %14.1f %12lu%s\n", mode.name, (ready - powered) / 1000.0,
+                   (unsigned long)st.probes, st.time_to_first_sync_us / 1000.0,
+                   (unsigned long)st.last_ready_us, err == ESP_OK ? "" : " (délai dépassé)");
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include <atomic>
+#include <cstring>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+namespace
+{
+    using namespace stusb4500;
+    using namespace stusb4500::literals;
+
+    const uint32_t SourcePdos[] = {
+        SinkPdo{5000_mV, 3000_mA}.encode(),
+        SinkPdo{9000_mV, 3000_mA}.encode(),
+        SinkPdo{15000_mV, 3000_mA}.encode(),
+    };
+
+    const char *event_name(EventType type)
+    {
+        switch (type)
+        {
+        case EventType::Attached:
+            return "attache";
+        case EventType::Detached:
+            return "détache";
+        case EventType::PdoChanged:
+            return "PDO modifiés";
+        case EventType::ContractChanged:
+            return "nouveau contrat";
+        case EventType::NvmDrift:
+            return "dérive NVM";
+        }
+        return "?";
+    }
+
+    // Rempli par la tâche de synchronisation, lu après coup par la tâche du banc
+    constexpr size_t MaxLogged = 16;
+    Event logged[MaxLogged];
+    std::atomic<size_t> logged_count{0};
+
+    bool wait_for(EventType type, uint32_t timeout_ms)
+    {
+        for (uint32_t waited = 0; waited < timeout_ms; waited += 10)
+        {
+            size_t n = logged_count.load();
+            for (size_t i = 0; i < n; ++i)
+                if (logged[i].type == type)
+                    return true;
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        return false;
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_events_bench()
+    {
+        // Puce absente au démarrage, NVM différente de la configuration attendue
+        static std::shared_ptr<emu::Emulator> chip = std::make_shared<emu::Emulator>();
+        uint8_t image[5][8];
+        memcpy(image, default_sector_config, sizeof(image));
+        image[4][6] ^= 0x01;
+        chip->load_nvm(image);
+        chip->attach_source(SourcePdos, sizeof(SourcePdos) / sizeof(SourcePdos[0]));
+        chip->set_online(false);
+
+        static std::unique_ptr<STUSB4500> dev = std::make_unique<STUSB4500>(chip);
+        int64_t start = esp_timer_get_time();
+
+        dev->subscribe([](const Event &e)
+                       {
+                           size_t n = logged_count.load();
+                           if (n < MaxLogged)
+                           {
+                               logged[n] = e;
+                               logged_count = n + 1;
+                           } });
+        QueueHandle_t contracts = xQueueCreate(4, sizeof(Event));
+        dev->subscribe(contracts, event_bit(EventType::ContractChanged));
+
+        chip->set_online(true);
+        wait_for(EventType::Attached, 2000);
+
+        PowerPolicy policy;
+        policy.max_voltage = 15.0f;
+        dev->submit(Command::apply_power_policy(policy));
+        wait_for(EventType::ContractChanged, 2000);
+
+        chip->set_online(false);
+        wait_for(EventType::Detached, 2000);
+        int64_t elapsed = esp_timer_get_time() - start;
+
+        printf("\n=== Événements : attache, dérive NVM, nouveau contrat, détache ===\n");
+        printf("%-16s %10s %8s %8s %10s %10s\n", "événement", "t_ms", "pdo_av", "pdo_ap", "rdo_av_mA", "rdo_ap_mA");
+        size_t n = logged_count.load();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const Event &e = logged[i];
+            printf("%-16s %10.1f %8u %8u %10u %10u", event_name(e.type), (e.timestamp_us - start) / 1000.0,
+                   e.before.pdo_numb, e.after.pdo_numb, e.before.operating_ma, e.after.operating_ma);
+            if (e.type == EventType::NvmDrift)
+            {
+                printf("  secteurs 0x%02X", e.nvm_drift);
+                for (int s = 0; s < 5; ++s)
+                    for (int b = 0; b < 8; ++b)
+                        if (e.nvm_expected[s][b] != e.nvm_actual[s][b])
+                            printf("  [%d][%d] %02X->%02X", s, b, e.nvm_expected[s][b], e.nvm_actual[s][b]);
+            }
+            printf("\n");
+        }
+
+        Event queued;
+        unsigned in_queue = 0;
+        while (xQueueReceive(contracts, &queued, 0) == pdTRUE)
+            in_queue++;
+        EventStats st = dev->get_event_stats();
+        printf("file (contrats seulement) : %u, publiés %lu, remis %lu, perdus %lu\n", in_queue,
+               (unsigned long)st.published, (unsigned long)st.delivered, (unsigned long)st.dropped);
+        printf("scrutation équivalente à 10 ms : %lld réveils pour %u événements\n",
+               (long long)(elapsed / 10000), (unsigned)n);
+    }
+}
@@ -0,0 +1,126 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+#include "stusb4500_fields.hpp"
+
+#include <cstring>
+#include "esp_timer.h"
+
+namespace
+{
+    using namespace stusb4500;
+
+    // === Versions manuelles (masques et décalages écrits à la main) ===
+    __attribute__((noinline)) int hand_get_flex(const uint8_t s[5][8])
+    {
+        return (((s[4][4] & 0x0F) << 6) | ((s[4][3] & 0xFC) >> 2)) * 10;
+    }
+
+    __attribute__((noinline)) int hand_get_upper3(const uint8_t s[5][8])
+    {
+        return (s[3][6] >> 4) + 5;
+    }
+
+    __attribute__((noinline)) void hand_set_flex(uint8_t s[5][8], int ma)
+    {
+        uint16_t raw = static_cast<uint16_t>((ma + 5) / 10);
+        s[4][3] = (s[4][3] & ~0xFC) | ((raw & 0x3F) << 2);
+        s[4][4] = (s[4][4] & ~0x0F) | ((raw >> 6) & 0x0F);
+    }
+
+    __attribute__((noinline)) void hand_set_pdo3(uint8_t s[5][8], int mv, int code)
+    {
+        uint16_t raw = static_cast<uint16_t>((mv + 25) / 50);
+        s[4][2] = raw & 0xFF;
+        s[4][3] = (s[4][3] & ~0x03) | ((raw >> 8) & 0x03);
+        s[3][5] = (s[3][5] & ~0xF0) | ((code & 0x0F) << 4);
+    }
+
+    // === Versions par descripteurs ===
+    __attribute__((noinline)) int field_get_flex(const uint8_t s[5][8])
+    {
+        return nvm::get<nvm::FlexCurrent>(s);
+    }
+
+    __attribute__((noinline)) int field_get_upper3(const uint8_t s[5][8])
+    {
+        return nvm::get<nvm::Pdo3UpperLimit>(s);
+    }
+
+    __attribute__((noinline)) void field_set_flex(uint8_t s[5][8], int ma)
+    {
+        nvm::set<nvm::FlexCurrent>(s, ma);
+    }
+
+    __attribute__((noinline)) void field_set_pdo3(uint8_t s[5][8], int mv, int code)
+    {
+        nvm::set_fields<nvm::Pdo3Voltage, nvm::Pdo3Current>(s, mv, code);
+    }
+
+    constexpr int Iterations = 1000000;
+
+    template <typename Fn>
+    double ns_per_op(Fn &&fn)
+    {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < Iterations; ++i)
+            fn(i);
+        return (esp_timer_get_time() - start) * 1000.0 / Iterations;
+    }
+
+    // Vérifie que les deux versions produisent les mêmes octets
+    bool same_results()
+    {
+        uint8_t a[5][8], b[5][8];
+        uint32_t seed = 0x12345678;
+        for (int n = 0; n < 1000; ++n)
+        {
+            for (auto &row : a)
+                for (auto &byte : row)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    byte = static_cast<uint8_t>(seed >> 24);
+                }
+            memcpy(b, a, sizeof(a));
+            if (hand_get_flex(a) != field_get_flex(a) || hand_get_upper3(a) != field_get_upper3(a))
+                return false;
+
+            int ma = (seed >> 8) % 5001;
+            int mv = ((seed >> 4) % 1024) * 50;
+            int code = seed % 16;
+            hand_set_flex(a, ma);
+            field_set_flex(b, ma);
+            hand_set_pdo3(a, mv, code);
+            field_set_pdo3(b, mv, code);
+            if (memcmp(a, b, sizeof(a)) != 0)
+                return false;
+        }
+        return true;
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_fields_bench()
+    {
+        printf("\n=== Descripteurs de champs NVM ===\n");
+        printf("résultats identiques : %s\n", same_results() ? "oui" : "NON");
+
+        uint8_t s[5][8];
+        memcpy(s, default_sector_config, sizeof(s));
+        volatile int sink = 0;
+
+        printf("%-24s %10s %10s\n", "opération", "manuel_ns", "champ_ns");
+        printf("%-24s %10.2f %10.2f\n", "get flex current",
+               ns_per_op([&](int i) { s[4][3] ^= i; sink = sink + hand_get_flex(s); }),
+               ns_per_op([&](int i) { s[4][3] ^= i; sink = sink + field_get_flex(s); }));
+        printf("%-24s %10.2f %10.2f\n", "get upper limit PDO3",
+               ns_per_op([&](int i) { s[3][6] ^= i; sink = sink + hand_get_upper3(s); }),
+               ns_per_op([&](int i) { s[3][6] ^= i; sink = sink + field_get_upper3(s); }));
+        printf("%-24s %10.2f %10.2f\n", "set flex current",
+               ns_per_op([&](int i) { hand_set_flex(s, i % 5000); }),
+               ns_per_op([&](int i) { field_set_flex(s, i % 5000); }));
+        printf("%-24s %10.2f %10.2f\n", "set PDO3 (V + I)",
+               ns_per_op([&](int i) { hand_set_pdo3(s, i % 20000, i & 0x0F); }),
+               ns_per_op([&](int i) { field_set_pdo3(s, i % 20000, i & 0x0F); }));
+    }
+}
@@ -0,0 +1,119 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+#include "stusb4500_fields.hpp"
+
+#include <atomic>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace
+{
+    using namespace stusb4500;
+
+    constexpr int Rounds = 20;
+
+    struct ReaderArgs
+    {
+        STUSB4500 *dev;
+        std::atomic<int> failures{0};
+        std::atomic<bool> done{false};
+    };
+
+    // Relectures NVM concurrentes, comme la tâche de synchronisation à l'attache
+    void nvm_reader(void *arg)
+    {
+        auto *args = static_cast<ReaderArgs *>(arg);
+        for (int i = 0; i < Rounds; ++i)
+            if (args->dev->read_sectors() != ESP_OK)
+                args->failures++;
+        args->done = true;
+        vTaskDelete(nullptr);
+    }
+
+    struct VolatileArgs
+    {
+        STUSB4500 *dev;
+        std::atomic<bool> stop{false};
+        std::atomic<bool> done{false};
+        uint32_t samples = 0;
+        uint32_t max_us = 0;
+    };
+
+    // Synchronisation volatile (alerte, resynchronisation périodique) pendant les commits
+    void volatile_syncer(void *arg)
+    {
+        auto *args = static_cast<VolatileArgs *>(arg);
+        while (!args->stop)
+        {
+            int64_t start = esp_timer_get_time();
+            args->dev->sync_volatile();
+            args->max_us = std::max(args->max_us, static_cast<uint32_t>(esp_timer_get_time() - start));
+            args->samples++;
+            vTaskDelay(1);
+        }
+        args->done = true;
+        vTaskDelete(nullptr);
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_guard_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        dev.reset_guard_stats();
+
+        static ReaderArgs args; // la tâche peut survivre à la portée (vTaskDelete simulé)
+        args.dev = &dev;
+        args.failures = 0;
+        args.done = false;
+        xTaskCreate(nvm_reader, "nvm_reader", 4096, &args, 5, nullptr);
+
+        static VolatileArgs sync; // idem
+        sync.dev = &dev;
+        sync.stop = false;
+        sync.done = false;
+        sync.samples = 0;
+        sync.max_us = 0;
+        xTaskCreate(volatile_syncer, "volatile_sync", 4096, &sync, 5, nullptr);
+
+        // Tâche applicative : commits NVM entrelacés
+        int64_t max_commit_us = 0;
+        int commit_failures = 0;
+        uint8_t last = 0;
+        for (int i = 0; i < Rounds; ++i)
+        {
+            last = static_cast<uint8_t>(i % 4);
+            int64_t start = esp_timer_get_time();
+            if (dev.begin_config().set_gpio_ctrl(last).commit() != ESP_OK)
+                commit_failures++;
+            max_commit_us = std::max(max_commit_us, esp_timer_get_time() - start);
+        }
+        while (!args.done)
+            vTaskDelay(1);
+        sync.stop = true;
+        while (!sync.done)
+            vTaskDelay(1);
+
+        uint8_t image[5][8];
+        chip.get_nvm(image);
+        GuardStats g = dev.get_guard_stats();
+
+        printf("\n=== Garde de séquence : %d commits NVM contre %d relectures concurrentes ===\n", Rounds, Rounds);
+        printf("échecs commit/relecture   : %d / %d\n", commit_failures, args.failures.load());
+        printf("NVM finale cohérente      : %s\n", nvm::get<nvm::GpioCtrl>(image) == last ? "oui" : "NON");
+        printf("séquences / attentes      : %lu / %lu\n", (unsigned long)g.acquisitions, (unsigned long)g.contended);
+        printf("attente moy / max (us)    : %lu / %lu\n",
+               (unsigned long)(g.contended ? g.total_wait_us / g.contended : 0), (unsigned long)g.max_wait_us);
+        printf("détention max (us)        : %lu\n", (unsigned long)g.max_hold_us);
+        printf("dernier bloqueur          : %s\n", g.last_blocker[0] ? g.last_blocker : "-");
+        printf("commit max (us)           : %lu\n", (unsigned long)max_commit_us);
+        printf("sync_volatile max (us)    : %lu (%lu appels pendant les commits)\n",
+               (unsigned long)sync.max_us, (unsigned long)sync.samples);
+
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+    }
+}
@@ -0,0 +1,34 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+using namespace stusb4500;
+
+extern "C" void app_main(void)
+{
+    auto chip = std::make_shared<emu::Emulator>();
+    chip->load_nvm(default_sector_config);
+
+    STUSB4500 dev(chip);
+    while (!dev.is_available())
+        vTaskDelay(pdMS_TO_TICKS(10));
+
+    bench::run_api_bench(*chip, dev);
+    bench::run_config_bench(*chip, dev);
+    bench::print_ftp_stats(dev);
+    bench::run_command_bench(*chip, dev);
+    bench::run_fields_bench();
+    bench::run_micro_bench();
+    bench::run_bus_bench();
+    bench::run_policy_bench(*chip, dev);
+    bench::run_reneg_bench(*chip, dev, 50);
+    bench::run_store_bench(*chip, dev);
+    bench::run_verify_bench(*chip, dev);
+    bench::run_guard_bench(*chip, dev);
+    bench::run_profile_bench(*chip, dev);
+    bench::run_detect_bench(1200);
+    bench::run_events_bench();
+    bench::run_manager_bench(4);
+}
@@ -0,0 +1,54 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+#include "stusb4500_manager.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace stusb4500::bench
+{
+    void run_manager_bench(size_t count)
+    {
+        printf("\n=== Gestionnaire : %u périphériques, une tâche ===\n", (unsigned)count);
+
+        std::vector<std::shared_ptr<emu::Emulator>> chips;
+        std::vector<std::unique_ptr<STUSB4500>> devs;
+        DeviceManager manager;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            chips.push_back(std::make_shared<emu::Emulator>());
+            chips.back()->load_nvm(default_sector_config);
+            devs.push_back(std::make_unique<STUSB4500>(chips.back(), false));
+            manager.add(*devs.back());
+        }
+        manager.start();
+
+        for (auto &dev : devs)
+            while (!dev->is_available())
+                vTaskDelay(pdMS_TO_TICKS(10));
+        vTaskDelay(pdMS_TO_TICKS(500));
+
+        printf("%-8s %8s %8s %10s %10s\n", "device", "services", "alerts", "avg_us", "max_us");
+        for (size_t i = 0; i < manager.size(); ++i)
+        {
+            ServiceStats st = manager.get_service_stats(i);
+            printf("%-8u %8lu %8lu %10lu %10lu\n", (unsigned)i,
+                   (unsigned long)st.services, (unsigned long)st.alerts,
+                   (unsigned long)(st.services ? st.total_us / st.services : 0),
+                   (unsigned long)st.max_us);
+        }
+
+        // L'instance est la même dans les deux modes : le gestionnaire ne remplace que la
+        // pile de la tâche propre (4096 o, cf. start_sync_task) par une entrée de suivi
+        size_t instance = sizeof(STUSB4500);
+        size_t entry = sizeof(STUSB4500 *) + sizeof(TickType_t) + sizeof(ServiceStats);
+        size_t own_stack = 4096;
+        size_t shared_stack = ManagerConfig{}.stack_size;
+        printf("mémoire/périphérique : instance %u o (deux modes) + pile %u o (tâche propre) ou entrée %u o (gestionnaire)\n",
+               (unsigned)instance, (unsigned)own_stack, (unsigned)entry);
+        printf("mémoire totale x%u   : tâches propres %u o, gestionnaire %u o (pile partagée %u o)\n",
+               (unsigned)count, (unsigned)(count * (instance + own_stack)),
+               (unsigned)(shared_stack + count * (instance + entry)), (unsigned)shared_stack);
+    }
+}
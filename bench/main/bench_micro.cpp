@@ -0,0 +1,100 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+#include "stusb4500_fields.hpp"
+#include "stusb4500_internal.hpp"
+
+#include <cstring>
+#include "esp_timer.h"
+
+namespace
+{
+    using namespace stusb4500;
+
+    struct Result
+    {
+        double ns_per_op;
+        double allocs_per_op;
+        double tx_per_op;
+    };
+
+    // Toutes les valeurs exposées par les accesseurs NVM, décodées depuis l'image
+    __attribute__((noinline)) int decode_all(const uint8_t s[5][8], PDO pdos[3])
+    {
+        STUSB4500::decode_pdos(s, pdos);
+        return nvm::get<nvm::SnkPdoNumb>(s) + nvm::get<nvm::FlexCurrent>(s) +
+               nvm::get<nvm::Pdo1UpperLimit>(s) + nvm::get<nvm::Pdo2LowerLimit>(s) +
+               nvm::get<nvm::Pdo2UpperLimit>(s) + nvm::get<nvm::Pdo3LowerLimit>(s) +
+               nvm::get<nvm::Pdo3UpperLimit>(s) + nvm::get<nvm::ExternalPower>(s) +
+               nvm::get<nvm::UsbCommCapable>(s) + nvm::get<nvm::ConfigOkGpio>(s) +
+               nvm::get<nvm::GpioCtrl>(s) + nvm::get<nvm::PowerAbove5vOnly>(s) +
+               nvm::get<nvm::ReqSrcCurrent>(s);
+    }
+
+    // Mêmes valeurs par l'API publique (un instantané par accesseur)
+    __attribute__((noinline)) int public_getters(STUSB4500 &dev)
+    {
+        int sum = dev.get_pdo_number() + dev.get_flex_current_ma().value;
+        for (uint8_t pdo = 1; pdo <= 3; ++pdo)
+            sum += dev.get_voltage_mv(pdo).value + dev.get_current_ma(pdo).value +
+                   dev.get_upper_voltage_limit(pdo) + dev.get_lower_voltage_limit(pdo);
+        return sum + dev.get_external_power() + dev.get_usb_comm_capable() + dev.get_config_ok_gpio() +
+               dev.get_gpio_ctrl() + dev.get_power_above_5v_only() + dev.get_req_src_current();
+    }
+
+    template <typename Fn>
+    Result run(STUSB4500 *dev, int iterations, Fn &&fn)
+    {
+        fn(); // préchauffage (caches, estimations FTP)
+        uint32_t tx = dev ? dev->get_bus_stats().transactions : 0;
+        uint64_t allocs = bench::alloc_count();
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < iterations; ++i)
+            fn();
+        int64_t elapsed = esp_timer_get_time() - start;
+        allocs = bench::alloc_count() - allocs;
+        tx = dev ? dev->get_bus_stats().transactions - tx : 0;
+        return Result{elapsed * 1000.0 / iterations, static_cast<double>(allocs) / iterations,
+                      static_cast<double>(tx) / iterations};
+    }
+
+    void print(const char *name, const Result &r, bool no_alloc)
+    {
+        // Seuil de non-régression : aucune allocation sur les chemins chauds
+        const char *gate = no_alloc && r.allocs_per_op > 0 ? "ÉCHEC" : "ok";
+        printf("%-36s %10.1f %9.2f %8.1f %6s\n", name, r.ns_per_op, r.allocs_per_op, r.tx_per_op, gate);
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_micro_bench()
+    {
+        auto chip = std::make_shared<emu::Emulator>();
+        chip->load_nvm(default_sector_config);
+        STUSB4500 dev(chip, false); // sans tâche : itérations pilotées ici
+        dev.run_once();
+        dev.read();
+
+        uint8_t image[5][8], other[5][8];
+        memcpy(image, default_sector_config, sizeof(image));
+        memcpy(other, image, sizeof(other));
+        other[4][7] ^= 0x80; // différence sur le dernier octet : pire cas de comparaison
+        PDO pdos[3];
+        volatile int sink = 0;
+
+        printf("\n=== Micro-bancs (hôte) ===\n");
+        printf("%-36s %10s %9s %8s %6s\n", "opération", "ns/op", "alloc/op", "tx/op", "seuil");
+        print("décodage image -> PDO + champs", run(nullptr, 1000000, [&] {
+                  image[3][2] ^= 0x10; // empêche le calcul hors boucle
+                  sink = sink + decode_all(image, pdos);
+              }), true);
+        print("accesseurs publics (instantanés)", run(&dev, 100000, [&] { sink = sink + public_getters(dev); }), true);
+        print("write_sectors() sans changement", run(&dev, 100000, [&] { dev.write_sectors(); }), true);
+        print("compare_sector() identiques", run(nullptr, 1000000, [&] { sink = sink + compare_sector(image, image); }), true);
+        print("compare_sector() dernier octet", run(nullptr, 1000000, [&] { sink = sink + compare_sector(image, other); }), true);
+        print("itération sync (présence)", run(&dev, 2000, [&] { dev.run_once(); }), true);
+        print("itération sync (alerte)", run(&dev, 2000, [&] { dev.run_once(true); }), true);
+        dev.set_sync_mode(SyncMode::Nvm);
+        print("itération sync (alerte, mode NVM)", run(&dev, 200, [&] { dev.run_once(true); }), true);
+    }
+}
@@ -0,0 +1,82 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace
+{
+    using namespace stusb4500;
+    using namespace stusb4500::literals;
+
+    // Source 5 V / 9 V / 12 V à 3 A, 15 V / 2 A, 20 V / 1,5 A
+    const uint32_t SourcePdos[] = {
+        SinkPdo{5000_mV, 3000_mA}.encode(),
+        SinkPdo{9000_mV, 3000_mA}.encode(),
+        SinkPdo{12000_mV, 3000_mA}.encode(),
+        SinkPdo{15000_mV, 2000_mA}.encode(),
+        SinkPdo{20000_mV, 1500_mA}.encode(),
+    };
+    constexpr float TargetPower = 36.0f; // W
+}
+
+namespace stusb4500::bench
+{
+    void run_policy_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        print_header("Sélection de contrat (36 W)");
+
+        chip.load_nvm(default_sector_config);
+        chip.attach_source(SourcePdos, sizeof(SourcePdos) / sizeof(SourcePdos[0]));
+        dev.sync_volatile(); // capture Source_Capabilities (fait par l'ALERT en usage réel)
+
+        // Ancienne méthode : essais successifs sans connaître la source
+        emu::Counters trial = measure(chip, "essais set_voltage/soft_reset", [&]
+                {
+                    const float tries[] = {20.0f, 15.0f, 12.0f, 9.0f};
+                    for (float v : tries)
+                    {
+                        dev.set_voltage(3, v);
+                        dev.set_current(3, TargetPower / v);
+                        dev.set_pdo_number(3);
+                        dev.soft_reset();
+                        vTaskDelay(pdMS_TO_TICKS(50)); // délai de renégociation
+                        dev.sync_volatile();
+                        uint32_t rdo = dev.get_volatile_regs().rdo;
+                        uint32_t pos = rdo >> 28;
+                        uint32_t mw = pos ? SinkPdo::decode(SourcePdos[pos - 1]).voltage.value * ((rdo >> 10) & 0x3FF) / 100 : 0;
+                        if (mw >= TargetPower * 1000)
+                            break; // puissance visée obtenue
+                    }
+                });
+
+        chip.load_nvm(default_sector_config);
+        dev.sync_volatile();
+        PowerPolicy policy;
+        policy.target_power = TargetPower;
+        emu::Counters engine = measure(chip, "apply_power_policy()", [&]
+                { dev.apply_power_policy(policy); });
+
+        vTaskDelay(pdMS_TO_TICKS(50));
+        dev.sync_volatile();
+        uint32_t rdo = dev.get_volatile_regs().rdo;
+        SourceCapabilities caps = dev.get_source_capabilities();
+        printf("renégociations : essais %lu, moteur %lu ; contrat PDO source %lu (%lu mV, %lu mA)\n",
+               (unsigned long)trial.soft_resets, (unsigned long)engine.soft_resets,
+               (unsigned long)(rdo >> 28), (unsigned long)SinkPdo::decode(caps.pdo[(rdo >> 28) - 1]).voltage.value,
+               (unsigned long)((rdo >> 10 & 0x3FF) * 10));
+
+        // Coût du calcul seul
+        constexpr int Iterations = 100000;
+        volatile uint8_t sink = 0;
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < Iterations; ++i)
+        {
+            policy.target_power = static_cast<float>(10 + i % 50);
+            sink = sink + select_sink_pdos(caps, policy).count;
+        }
+        printf("select_sink_pdos() : %.1f ns/appel\n",
+               (esp_timer_get_time() - start) * 1000.0 / Iterations);
+    }
+}
@@ -0,0 +1,48 @@
+#include "bench.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace stusb4500::bench
+{
+    void run_profile_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        printf("\n=== Trafic I2C par API ===\n");
+#if !CONFIG_STUSB4500_PROFILING
+        printf("CONFIG_STUSB4500_PROFILING désactivé : aucun compteur\n");
+        return;
+#endif
+        dev.reset_api_profiles();
+        const uint32_t tx0 = chip.counters().transactions;
+
+        // Charge mixte : appels directs, file de commandes et tâche de synchronisation
+        dev.read_sectors();
+        dev.set_gpio_ctrl(1);
+        dev.set_voltage(2, 9.0f);
+        dev.set_pdo_number(2);
+        dev.get_pdo_number();
+        auto ticket = dev.submit(Command::set_flex_current(2.0f));
+        if (ticket)
+            dev.wait(*ticket, pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(200));
+
+        const uint32_t bus_tx = chip.counters().transactions - tx0;
+
+        printf("%-26s %6s %7s %5s %10s %8s\n", "api", "tx", "bytes", "err", "total_ms", "max_us");
+        uint32_t attributed = 0;
+        for (size_t i = 0; i < static_cast<size_t>(ProfileApi::Count); ++i)
+        {
+            ProfileApi api = static_cast<ProfileApi>(i);
+            ApiProfile p = dev.get_api_profile(api);
+            if (p.transactions == 0)
+                continue;
+            attributed += p.transactions;
+            printf("%-26s %6lu %7lu %5lu %10.2f %8lu\n", profile_api_name(api),
+                   (unsigned long)p.transactions, (unsigned long)p.bytes, (unsigned long)p.errors,
+                   p.total_us / 1000.0, (unsigned long)p.max_us);
+        }
+        // Chaque transaction est attribuée à une seule API (la plus externe, sinon
+        // Other) : la somme doit couvrir le trafic vu par l'émulateur
+        printf("attribuées %lu / émulateur %lu transactions\n", (unsigned long)attributed, (unsigned long)bus_tx);
+    }
+}
@@ -0,0 +1,103 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace
+{
+    using namespace stusb4500;
+    using namespace stusb4500::literals;
+
+    const uint32_t SourcePdos[] = {
+        SinkPdo{5000_mV, 3000_mA}.encode(),
+        SinkPdo{9000_mV, 3000_mA}.encode(),
+        SinkPdo{15000_mV, 3000_mA}.encode(),
+        SinkPdo{20000_mV, 2250_mA}.encode(),
+    };
+
+    void print_phase(const char *name, const LatencyStats &s)
+    {
+        printf("%-16s %6lu %8lu %8lu %8lu %8lu %8lu %8lu\n", name, (unsigned long)s.count,
+               (unsigned long)s.min_us, (unsigned long)s.avg_us, (unsigned long)s.p50_us,
+               (unsigned long)s.p90_us, (unsigned long)s.p99_us, (unsigned long)s.max_us);
+    }
+
+    // Alterne deux jeux de PDO et attend chaque nouveau contrat
+    void switch_loop(STUSB4500 &dev, const SinkPdoSet sets[2], int cycles)
+    {
+        dev.reset_renegotiation_stats();
+        for (int i = 0; i < cycles; ++i)
+        {
+            dev.apply_sink_pdos(sets[i & 1]);
+            for (int wait = 0; wait < 200; ++wait)
+            {
+                RenegotiationStats st = dev.get_renegotiation_stats();
+                if (st.total.count + st.timeouts > static_cast<uint32_t>(i))
+                    break;
+                vTaskDelay(1);
+            }
+        }
+
+        RenegotiationStats st = dev.get_renegotiation_stats();
+        printf("%-16s %6s %8s %8s %8s %8s %8s %8s\n", "phase (us)", "n", "min", "avg", "p50", "p90", "p99", "max");
+        print_phase("PDO -> reset", st.pdo_to_reset);
+        print_phase("reset -> alerte", st.reset_to_alert);
+        print_phase("alerte -> RDO", st.alert_to_rdo);
+        print_phase("total", st.total);
+        printf("renégociations %lu, même contrat %lu, expirées %lu\n", (unsigned long)st.started,
+               (unsigned long)st.same_contract, (unsigned long)st.timeouts);
+    }
+
+    // SOFT_RESET seul : la source renégocie le contrat en place (RDO inchangé)
+    void same_contract_loop(STUSB4500 &dev, int cycles)
+    {
+        dev.reset_renegotiation_stats();
+        for (int i = 0; i < cycles; ++i)
+        {
+            dev.soft_reset();
+            for (int wait = 0; wait < 200; ++wait)
+            {
+                RenegotiationStats st = dev.get_renegotiation_stats();
+                if (st.total.count + st.timeouts > static_cast<uint32_t>(i))
+                    break;
+                vTaskDelay(1);
+            }
+        }
+
+        RenegotiationStats st = dev.get_renegotiation_stats();
+        print_phase("total", st.total);
+        printf("renégociations %lu, même contrat %lu, expirées %lu\n", (unsigned long)st.started,
+               (unsigned long)st.same_contract, (unsigned long)st.timeouts);
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_reneg_bench(emu::Emulator &chip, STUSB4500 &dev, int cycles)
+    {
+        chip.load_nvm(default_sector_config);
+        chip.attach_source(SourcePdos, sizeof(SourcePdos) / sizeof(SourcePdos[0]));
+        dev.sync_volatile();
+
+        PowerPolicy low, high;
+        low.max_voltage = 9.0f;
+        high.max_voltage = 15.0f;
+        const SinkPdoSet sets[2] = {
+            select_sink_pdos(dev.get_source_capabilities(), low),
+            select_sink_pdos(dev.get_source_capabilities(), high),
+        };
+
+        printf("\n=== Renégociation 9 V <-> 15 V, %d cycles, sans ALERT (scrutation) ===\n", cycles);
+        switch_loop(dev, sets, cycles);
+
+        // Broche ALERT simulée : l'émulateur appelle l'ISR du driver
+        chip.set_alert_callback([&dev] { STUSB4500::alert_isr_handler(&dev); });
+        dev.configure_alert_pin(GPIO_NUM_25);
+        printf("\n=== Renégociation 9 V <-> 15 V, %d cycles, avec ALERT ===\n", cycles);
+        switch_loop(dev, sets, cycles);
+
+        printf("\n=== SOFT_RESET sans changement de contrat, %d cycles, avec ALERT ===\n", cycles / 5);
+        same_contract_loop(dev, cycles / 5);
+    }
+}
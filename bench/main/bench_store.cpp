@@ -0,0 +1,69 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+#include "stusb4500_fields.hpp"
+
+#include <cstring>
+
+namespace
+{
+    using namespace stusb4500;
+
+    // Profil sink : PDO1 seul en 5 V, sinon PDO2 à la tension demandée
+    void make_image(uint8_t image[5][8], uint32_t mv, uint32_t ma)
+    {
+        memcpy(image, default_sector_config, 40);
+        uint8_t code = codec::nvm_current_code(Milliamps(ma));
+        if (mv == 5000)
+            nvm::set_fields<nvm::SnkPdoNumb, nvm::Pdo1Current>(image, 1, code);
+        else
+            nvm::set_fields<nvm::SnkPdoNumb, nvm::Pdo2Voltage, nvm::Pdo2Current>(image, 2, mv, code);
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_store_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        struct
+        {
+            const char *name;
+            uint32_t mv;
+            uint32_t ma;
+        } sinks[] = {{"5V", 5000, 3000}, {"9V_2A", 9000, 2000}, {"15V_3A", 15000, 3000}, {"20V_2A25", 20000, 2250}};
+
+        ProfileStore store;
+        for (const auto &s : sinks)
+        {
+            uint8_t image[5][8];
+            make_image(image, s.mv, s.ma);
+            store.add(s.name, image);
+        }
+
+        // Aller-retour par fichier (backend interchangeable)
+        FileProfileBackend file("stusb4500_profiles.bin");
+        ProfileStore reloaded;
+        esp_err_t saved = store.save(file);
+        esp_err_t loaded = reloaded.load(file);
+        printf("\n=== Profils NVM : %u profils, %u octets, sauvegarde %s, relecture %s ===\n",
+               (unsigned)reloaded.size(), (unsigned)store.encoded_size(),
+               esp_err_to_name(saved), esp_err_to_name(loaded));
+
+        print_header("Bascule de profil (depuis le précédent)");
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        for (size_t i = 0; i < reloaded.size(); ++i)
+        {
+            const NvmProfile &p = reloaded.at(i);
+            uint8_t preview = 0;
+            dev.diff_nvm_profile(p, preview);
+
+            char label[48];
+            snprintf(label, sizeof(label), "apply %s (diff 0x%02X)", p.name, preview);
+            measure(chip, label, [&] { dev.apply_nvm_profile(p); });
+        }
+
+        // Référence : image complète reprogrammée à chaque bascule
+        const NvmProfile &last = reloaded.at(0);
+        measure(chip, "program_sectors() 5 secteurs", [&] { dev.program_sectors(last.image, 0x1F); });
+    }
+}
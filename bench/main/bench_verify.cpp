@@ -0,0 +1,66 @@
+#include "bench.hpp"
+#include "stusb4500_conf.hpp"
+
+#include <cstring>
+
+namespace
+{
+    using namespace stusb4500;
+
+    void print_sector_stats(STUSB4500 &dev)
+    {
+        printf("%-8s %8s %8s %8s %8s %11s %11s\n", "secteur", "prog", "echecs", "reprises", "perdus", "prog_us", "verif_us");
+        for (uint8_t i = 0; i < 5; ++i)
+        {
+            SectorProgramStats s = dev.get_sector_program_stats(i);
+            printf("%-8u %8lu %8lu %8lu %8lu %11lu %11lu\n", i,
+                   (unsigned long)s.programs, (unsigned long)s.verify_failures,
+                   (unsigned long)s.retries, (unsigned long)s.unrecovered,
+                   (unsigned long)s.max_program_us, (unsigned long)s.max_verify_us);
+        }
+    }
+}
+
+namespace stusb4500::bench
+{
+    void run_verify_bench(emu::Emulator &chip, STUSB4500 &dev)
+    {
+        uint8_t image[5][8];
+        memcpy(image, default_sector_config, sizeof(image));
+        image[3][2] ^= 0x10; // secteur 3 modifié : diff d'un seul secteur
+
+        print_header("Programmation vérifiée");
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        measure(chip, "program + read_sectors()", [&] {
+            dev.program_sectors(image, 0x1F);
+            dev.read_sectors();
+        });
+
+        dev.set_program_config(ProgramConfig{.verify = true, .retries = 2});
+        dev.reset_sector_program_stats();
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        measure(chip, "program vérifié (5 secteurs)", [&] { dev.program_sectors(image, 0x1F); });
+
+        // Une programmation ratée sur le secteur 3 : seul ce secteur est repris
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        chip.inject_program_faults(3, 1);
+        measure(chip, "program vérifié, 1 défaut", [&] { dev.program_sectors(image, 0x1F); });
+
+        // Défaut persistant : budget épuisé, erreur remontée
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+        chip.inject_program_faults(3, 10);
+        esp_err_t err = ESP_OK;
+        measure(chip, "program vérifié, défaut permanent", [&] { err = dev.program_sectors(image, 0x08); });
+        chip.inject_program_faults(3, 0);
+        printf("résultat : %s\n", esp_err_to_name(err));
+        print_sector_stats(dev);
+
+        dev.set_program_config(ProgramConfig{});
+        chip.load_nvm(default_sector_config);
+        dev.read_sectors();
+    }
+}
@@ -0,0 +1,484 @@
+#include "stusb4500_emulator.hpp"
+#include "STUSB4500_register_map.h"
+
+#include <cstring>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace
+{
+    constexpr uint8_t PdoBase = DPM_SNK_PDO1;
+
+    // Courant NVM (code 4 bits) en mA, 0 = courant "flex"
+    uint32_t nvm_current_ma(uint8_t code, uint32_t flex_ma)
+    {
+        if (code == 0)
+            return flex_ma;
+        return code < 11 ? 250 + code * 250 : code * 500 - 2500;
+    }
+
+    uint32_t sink_pdo(uint32_t voltage_50mv, uint32_t current_ma)
+    {
+        return ((voltage_50mv & 0x3FF) << 10) | ((current_ma / 10) & 0x3FF);
+    }
+}
+
+namespace stusb4500::emu
+{
+    Emulator::Emulator(const Timing &timing)
+        : timing(timing)
+    {
+        last_host_us = esp_timer_get_time();
+        power_on_reset();
+        pd_thread = std::thread(&Emulator::pd_loop, this);
+    }
+
+    Emulator::~Emulator()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        pd_cv.notify_all();
+        pd_thread.join();
+    }
+
+    void Emulator::set_online(bool value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (value && !online)
+        {
+            // Mise sous tension : registres rechargés, attache CC signalée sur ALERT
+            power_on_reset();
+            regs[ALERT_STATUS_1] |= CC_DETECTION_STATUS_AL;
+            alert_raised = true;
+            pd_cv.notify_all();
+        }
+        online = value;
+    }
+
+    void Emulator::set_timing(const Timing &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        timing = value;
+    }
+
+    void Emulator::inject_program_faults(uint8_t sector, uint32_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sector < 5)
+            program_faults[sector] = count;
+    }
+
+    void Emulator::load_nvm(const uint8_t image[5][8])
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        memcpy(nvm, image, sizeof(nvm));
+        power_on_reset();
+    }
+
+    void Emulator::get_nvm(uint8_t image[5][8])
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        memcpy(image, nvm, sizeof(nvm));
+    }
+
+    uint8_t Emulator::peek(uint8_t reg)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return regs[reg];
+    }
+
+    void Emulator::attach_source(const uint32_t *pdo, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        source_count = count < 7 ? count : 7;
+        memcpy(source_pdo, pdo, source_count * sizeof(uint32_t));
+        send_source_capabilities();
+        negotiate();
+        pd_cv.notify_all();
+    }
+
+    void Emulator::set_alert_callback(std::function<void()> cb)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        alert_callback = std::move(cb);
+    }
+
+    Counters Emulator::counters()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return totals;
+    }
+
+    void Emulator::reset_counters()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        totals = {};
+    }
+
+    void Emulator::begin_capture()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sync_clock();
+        capture = {};
+        capture.modeled_us = clock_us;
+        capture_task = xTaskGetCurrentTaskHandle();
+    }
+
+    Counters Emulator::end_capture()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sync_clock();
+        capture.modeled_us = clock_us - capture.modeled_us;
+        capture_task = nullptr;
+        return capture;
+    }
+
+    uint64_t Emulator::now_us()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sync_clock();
+        return clock_us;
+    }
+
+    esp_err_t Emulator::read(uint8_t reg, uint8_t *data, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        account(true, len);
+        if (!online)
+            return ESP_FAIL;
+
+        process_pd_events();
+        for (size_t i = 0; i < len; ++i)
+            data[i] = load(static_cast<uint8_t>(reg + i));
+        return ESP_OK;
+    }
+
+    esp_err_t Emulator::write(uint8_t reg, const uint8_t *data, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        account(false, len);
+        if (!online)
+            return ESP_FAIL;
+
+        // Auto-incrément : chaque octet est traité dans l'ordre des adresses
+        for (size_t i = 0; i < len; ++i)
+            store(static_cast<uint8_t>(reg + i), data[i]);
+        return ESP_OK;
+    }
+
+    void Emulator::power_on_reset()
+    {
+        memset(regs, 0, sizeof(regs));
+        memset(page_latch, 0, sizeof(page_latch));
+        erase_mask = 0;
+        ftp_busy_until = 0;
+
+        // Les PDO volatiles sont chargés depuis la NVM à la mise sous tension
+        uint32_t flex_ma = (((nvm[4][4] & 0x0F) << 6) | ((nvm[4][3] & 0xFC) >> 2)) * 10;
+        uint32_t pdo[3] = {
+            sink_pdo(100, nvm_current_ma((nvm[3][2] & 0xF0) >> 4, flex_ma)),
+            sink_pdo((nvm[4][1] << 2) | (nvm[4][0] >> 6), nvm_current_ma(nvm[3][4] & 0x0F, flex_ma)),
+            sink_pdo(((nvm[4][3] & 0x03) << 8) | nvm[4][2], nvm_current_ma((nvm[3][5] & 0xF0) >> 4, flex_ma)),
+        };
+        for (int i = 0; i < 3; ++i)
+            for (int b = 0; b < 4; ++b)
+                regs[PdoBase + i * 4 + b] = static_cast<uint8_t>(pdo[i] >> (8 * b));
+
+        regs[DPM_PDO_NUMB] = (nvm[3][2] >> 1) & 0x03;
+
+        // Contrat initial : PDO1 (position 1), courant opérationnel = courant max
+        uint32_t cur = pdo[0] & 0x3FF;
+        uint32_t rdo = (1u << 28) | (cur << 10) | cur;
+        for (int b = 0; b < 4; ++b)
+            regs[RDO_REG_STATUS_0 + b] = static_cast<uint8_t>(rdo >> (8 * b));
+        regs[PORT_STATUS_1] = 0x01; // ATTACH
+
+        // Source déjà présente : capacités reçues et contrat renégocié
+        if (source_count)
+        {
+            send_source_capabilities();
+            negotiate();
+        }
+    }
+
+    void Emulator::send_source_capabilities()
+    {
+        uint16_t header = 0x01 | (static_cast<uint16_t>(source_count) << 12); // Source_Capabilities
+        regs[RX_HEADER_LOW] = header & 0xFF;
+        regs[RX_HEADER_LOW + 1] = header >> 8;
+        for (size_t i = 0; i < source_count; ++i)
+            for (int b = 0; b < 4; ++b)
+                regs[RX_DATA_OBJ1 + i * 4 + b] = static_cast<uint8_t>(source_pdo[i] >> (8 * b));
+        regs[PRT_STATUS] |= PRT_STATUS_MSG_RECEIVED;
+        regs[ALERT_STATUS_1] |= PRT_STATUS_AL;
+        alert_raised = true;
+    }
+
+    void Emulator::negotiate()
+    {
+        // PDO sink de rang le plus élevé d'abord : même tension, courant disponible
+        uint32_t position = 1, cur = 0;
+        bool matched = false;
+        for (int s = (regs[DPM_PDO_NUMB] & 0x07) - 1; s >= 0 && !matched; --s)
+        {
+            uint32_t sink = 0;
+            for (int b = 0; b < 4; ++b)
+                sink |= static_cast<uint32_t>(regs[PdoBase + s * 4 + b]) << (8 * b);
+            for (size_t i = 0; i < source_count && !matched; ++i)
+            {
+                uint32_t src = source_pdo[i];
+                if ((src >> 30) == 0 && ((src >> 10) & 0x3FF) == ((sink >> 10) & 0x3FF) &&
+                    (src & 0x3FF) >= (sink & 0x3FF))
+                {
+                    position = static_cast<uint32_t>(i + 1);
+                    cur = sink & 0x3FF;
+                    matched = true;
+                }
+            }
+        }
+        if (!matched) // repli sur vSafe5V
+            cur = source_count ? (source_pdo[0] & 0x3FF) : 0;
+
+        uint32_t rdo = (position << 28) | (cur << 10) | cur;
+        for (int b = 0; b < 4; ++b)
+            regs[RDO_REG_STATUS_0 + b] = static_cast<uint8_t>(rdo >> (8 * b));
+        regs[ALERT_STATUS_1] |= PRT_STATUS_AL;
+        alert_raised = true;
+    }
+
+    void Emulator::send_ps_ready()
+    {
+        // PS_RDY : message de contrôle sans objet, écrase le tampon RX
+        uint16_t header = 0x06;
+        regs[RX_HEADER_LOW] = header & 0xFF;
+        regs[RX_HEADER_LOW + 1] = header >> 8;
+        regs[PRT_STATUS] |= PRT_STATUS_MSG_RECEIVED;
+        regs[ALERT_STATUS_1] |= PRT_STATUS_AL;
+        alert_raised = true;
+    }
+
+    uint32_t Emulator::jitter()
+    {
+        jitter_seed ^= jitter_seed << 13;
+        jitter_seed ^= jitter_seed >> 17;
+        jitter_seed ^= jitter_seed << 5;
+        return timing.reneg_jitter_us ? jitter_seed % (timing.reneg_jitter_us + 1) : 0;
+    }
+
+    void Emulator::process_pd_events()
+    {
+        int64_t now = esp_timer_get_time();
+        if (caps_at && now >= caps_at)
+        {
+            caps_at = 0;
+            send_source_capabilities();
+            contract_at = now + timing.reneg_contract_us + jitter();
+        }
+        if (contract_at && now >= contract_at)
+        {
+            contract_at = 0;
+            negotiate();
+            send_ps_ready(); // dernier message de la renégociation, même contrat ou non
+        }
+        if (alert_raised)
+            pd_cv.notify_all();
+    }
+
+    void Emulator::pd_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping)
+        {
+            process_pd_events();
+            if (alert_raised)
+            {
+                alert_raised = false;
+                auto cb = alert_callback;
+                if (cb)
+                {
+                    lock.unlock();
+                    cb();
+                    lock.lock();
+                }
+                continue;
+            }
+
+            int64_t next = caps_at ? caps_at : contract_at;
+            if (next)
+                pd_cv.wait_for(lock, std::chrono::microseconds(next - esp_timer_get_time()));
+            else
+                pd_cv.wait(lock);
+        }
+    }
+
+    void Emulator::sync_clock()
+    {
+        // Le temps passé hors du bus (délais, calcul) compte dans le temps modélisé
+        int64_t host_now = esp_timer_get_time();
+        clock_us += static_cast<uint64_t>(host_now - last_host_us);
+        last_host_us = host_now;
+    }
+
+    void Emulator::account(bool is_read, size_t len)
+    {
+        sync_clock();
+        uint64_t cost = timing.transaction_us + len * timing.byte_us;
+        clock_us += cost;
+
+        auto add = [&](Counters &c)
+        {
+            c.transactions++;
+            (is_read ? c.reads : c.writes)++;
+            c.bytes += len;
+        };
+        add(totals);
+        totals.modeled_us += cost;
+        if (capture_task && capture_task == xTaskGetCurrentTaskHandle())
+            add(capture);
+    }
+
+    uint8_t Emulator::load(uint8_t reg)
+    {
+        if (reg == FTP_CTRL_0 && (regs[FTP_CTRL_0] & FTP_CUST_REQ) && clock_us >= ftp_busy_until)
+            regs[FTP_CTRL_0] &= ~FTP_CUST_REQ;
+
+        // Registres d'alerte et d'état protocole effacés à la lecture
+        uint8_t value = regs[reg];
+        if (reg == ALERT_STATUS_1 || reg == PRT_STATUS)
+            regs[reg] = 0;
+        return value;
+    }
+
+    void Emulator::store(uint8_t reg, uint8_t value)
+    {
+        switch (reg)
+        {
+        case FTP_CTRL_0:
+            regs[reg] = value;
+            if (!(value & FTP_CUST_RST_N))
+            {
+                ftp_busy_until = 0;
+                regs[reg] &= ~FTP_CUST_REQ;
+            }
+            else if (value & FTP_CUST_REQ)
+            {
+                run_ftp_request(value);
+            }
+            break;
+
+        case DPM_PDO_NUMB:
+            regs[reg] = value & 0x07;
+            break;
+
+        case PD_COMMAND_CTRL:
+            regs[reg] = value;
+            if (value == 0x26 && regs[TX_HEADER_LOW] == 0x0D)
+            {
+                totals.soft_resets++;
+                if (capture_task && capture_task == xTaskGetCurrentTaskHandle())
+                    capture.soft_resets++;
+
+                // La source renvoie ses capacités puis un nouveau contrat est négocié
+                if (source_count)
+                {
+                    caps_at = esp_timer_get_time() + timing.reneg_caps_us + jitter();
+                    contract_at = 0;
+                    pd_cv.notify_all();
+                }
+            }
+            break;
+
+        default:
+            regs[reg] = value;
+            break;
+        }
+    }
+
+    void Emulator::run_ftp_request(uint8_t ctrl0)
+    {
+        bool unlocked = regs[FTP_CUST_PASSWORD_REG] == FTP_CUST_PASSWORD;
+        if (!unlocked || !(ctrl0 & FTP_CUST_PWR))
+        {
+            regs[FTP_CTRL_0] &= ~FTP_CUST_REQ;
+            return;
+        }
+
+        uint8_t sect = ctrl0 & FTP_CUST_SECT;
+        uint8_t *rw = &regs[RW_BUFFER];
+        uint32_t duration = 0;
+        uint32_t erased = 0, programmed = 0;
+
+        switch (regs[FTP_CTRL_1] & FTP_CUST_OPCODE)
+        {
+        case READ:
+            if (sect < 5)
+                memcpy(rw, nvm[sect], 8);
+            duration = timing.ftp_read_us;
+            break;
+        case WRITE_PL:
+            memcpy(page_latch, rw, 8);
+            duration = timing.ftp_write_pl_us;
+            break;
+        case WRITE_SER:
+            erase_mask = (regs[FTP_CTRL_1] & FTP_CUST_SER) >> 3;
+            duration = timing.ftp_write_ser_us;
+            break;
+        case SOFT_PROG_SECTOR:
+            for (int s = 0; s < 5; ++s)
+                if (erase_mask & (1 << s))
+                    memset(nvm[s], 0xFF, 8);
+            duration = timing.ftp_soft_prog_us;
+            break;
+        case ERASE_SECTOR:
+            for (int s = 0; s < 5; ++s)
+                if (erase_mask & (1 << s))
+                {
+                    memset(nvm[s], 0x00, 8);
+                    erased++;
+                }
+            duration = timing.ftp_erase_us;
+            break;
+        case PROG_SECTOR:
+            // La programmation ne fait que passer des bits à 1 : effacement requis
+            if (sect < 5)
+            {
+                uint8_t latch[8];
+                memcpy(latch, page_latch, 8);
+                if (program_faults[sect])
+                {
+                    // Cellule faible : le premier bit à 1 n'est pas programmé
+                    program_faults[sect]--;
+                    for (int i = 0; i < 8; ++i)
+                        if (latch[i])
+                        {
+                            latch[i] &= latch[i] - 1;
+                            break;
+                        }
+                }
+                for (int i = 0; i < 8; ++i)
+                    nvm[sect][i] |= latch[i];
+                programmed++;
+            }
+            duration = timing.ftp_prog_us;
+            break;
+        default:
+            break;
+        }
+
+        ftp_busy_until = clock_us + duration;
+
+        auto add = [&](Counters &c)
+        {
+            c.ftp_ops++;
+            c.erased_sectors += erased;
+            c.programmed_sectors += programmed;
+        };
+        add(totals);
+        if (capture_task && capture_task == xTaskGetCurrentTaskHandle())
+            add(capture);
+    }
+
+} // namespace stusb4500::emu
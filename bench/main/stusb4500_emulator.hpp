@@ -0,0 +1,130 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "esp_err.h"
+#include "I2CDevice.hpp"
+
+namespace stusb4500::emu {
+
+/**
+ * @brief Coûts modélisés du bus et des opérations FTP (en µs).
+ *
+ * Par défaut : I2C à 100 kHz (9 bits par octet) et temps NVM typiques.
+ */
+struct Timing {
+    uint32_t transaction_us = 200;   // START + adresse + registre (+ RESTART) + STOP
+    uint32_t byte_us = 90;           // par octet de données
+    uint32_t ftp_read_us = 50;
+    uint32_t ftp_write_pl_us = 20;
+    uint32_t ftp_write_ser_us = 20;
+    uint32_t ftp_soft_prog_us = 2000;
+    uint32_t ftp_erase_us = 5000;
+    uint32_t ftp_prog_us = 2000;
+
+    // Renégociation après SOFT_RESET (temps hôte réel) : Source_Capabilities, puis PS_RDY
+    uint32_t reneg_caps_us = 3000;
+    uint32_t reneg_contract_us = 20000;
+    uint32_t reneg_jitter_us = 4000;     // ajouté aléatoirement à chaque étape
+};
+
+/**
+ * @brief Compteurs de trafic I2C et d'activité NVM.
+ */
+struct Counters {
+    uint32_t transactions = 0;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t bytes = 0;
+    uint32_t ftp_ops = 0;
+    uint32_t erased_sectors = 0;
+    uint32_t programmed_sectors = 0;
+    uint32_t soft_resets = 0;
+    uint64_t modeled_us = 0;
+};
+
+/**
+ * @brief Émulateur registre à registre du STUSB4500 pour les tests sur hôte.
+ *
+ * Modélise la machine d'état FTP (FTP_CTRL_0 / FTP_CTRL_1 / RW_BUFFER), la NVM
+ * de 5 secteurs, les registres PDO volatiles (0x85-0x90) et DPM_PDO_NUMB, ainsi
+ * qu'une source PD : Source_Capabilities dans le tampon RX et choix du RDO à
+ * chaque (re)négociation.
+ * Le temps modélisé avance du coût de chaque transaction ainsi que du temps
+ * réellement écoulé sur l'hôte entre deux transactions.
+ */
+class Emulator : public I2CDevice {
+public:
+    explicit Emulator(const Timing& timing = {});
+    ~Emulator();
+
+    esp_err_t read(uint8_t reg, uint8_t* data, size_t len) override;
+    esp_err_t write(uint8_t reg, const uint8_t* data, size_t len) override;
+
+    // === Contrôle de la puce simulée ===
+    void set_online(bool online);
+    void set_timing(const Timing& timing);
+    void load_nvm(const uint8_t image[5][8]); // + reset à la mise sous tension
+    void get_nvm(uint8_t image[5][8]);
+    uint8_t peek(uint8_t reg);
+    void attach_source(const uint32_t* pdo, size_t count); // envoie Source_Capabilities
+    void set_alert_callback(std::function<void()> cb);      // front descendant d'ALERT
+    // Les count prochains PROG_SECTOR du secteur perdent un bit du page latch
+    void inject_program_faults(uint8_t sector, uint32_t count);
+
+    // === Mesure ===
+    Counters counters();
+    void reset_counters();
+    void begin_capture();     // ne compte que la tâche appelante
+    Counters end_capture();
+    uint64_t now_us();
+
+private:
+    std::mutex mutex;
+    Timing timing;
+    bool online = true;
+
+    uint8_t regs[256] = {};
+    uint8_t nvm[5][8] = {};
+    uint8_t page_latch[8] = {};
+    uint8_t erase_mask = 0;
+    uint32_t program_faults[5] = {};
+    uint64_t ftp_busy_until = 0;
+    uint32_t source_pdo[7] = {};
+    size_t source_count = 0;
+
+    // Événements PD différés, traités par pd_thread ou à la lecture suivante
+    int64_t caps_at = 0;       // 0 = aucun événement en attente
+    int64_t contract_at = 0;
+    bool alert_raised = false;
+    uint32_t jitter_seed = 0x2545F491;
+    std::function<void()> alert_callback;
+    std::condition_variable pd_cv;
+    bool stopping = false;
+    std::thread pd_thread;
+
+    uint64_t clock_us = 0;
+    int64_t last_host_us = 0;
+    Counters totals;
+    Counters capture;
+    void* capture_task = nullptr;
+
+    void power_on_reset();
+    void account(bool is_read, size_t len);
+    void sync_clock();
+    void store(uint8_t reg, uint8_t value);
+    void run_ftp_request(uint8_t ctrl0);
+    void send_source_capabilities();
+    void negotiate();
+    void send_ps_ready();
+    uint32_t jitter();
+    void process_pd_events();
+    void pd_loop();
+    uint8_t load(uint8_t reg);
+};
+
+} // namespace stusb4500::emu
@@ -14,7 +14,20 @@
 #define RW_BUFFER              0x53
 #define TX_HEADER_LOW          0x51
 #define PD_COMMAND_CTRL        0x1A
+#define PRT_STATUS             0x16
+#define PRT_STATUS_MSG_RECEIVED 0x04
+#define RX_HEADER_LOW          0x31
+#define RX_DATA_OBJ1           0x33
 #define DPM_PDO_NUMB           0x70
+#define DPM_SNK_PDO1           0x85
+#define RDO_REG_STATUS_0       0x91
+
+#define ALERT_STATUS_1         0x0B
+#define ALERT_STATUS_1_MASK    0x0C
+#define PORT_STATUS_0          0x0D
+#define PORT_STATUS_1          0x0E
+#define PRT_STATUS_AL          0x02
+#define CC_DETECTION_STATUS_AL 0x40
 
 #define READ                   0x00
 #define WRITE_PL               0x01
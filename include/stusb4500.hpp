@@ -1,17 +1,241 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
 #include <cstdint>
 #include <expected>
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
 #include "I2CDevice.hpp"
 #include "STUSB4500_register_map.h"
+#include "stusb4500_bus.hpp"
+#include "stusb4500_units.hpp"
+#include "stusb4500_telemetry.hpp"
+#include "stusb4500_events.hpp"
+#include "stusb4500_policy.hpp"
+#include "stusb4500_command.hpp"
+#include "stusb4500_profile.hpp"
+#include "stusb4500_nvm_profiles.hpp"
 
 namespace stusb4500 {
 
 struct PDO {
-    float voltage;  // en Volts
-    float current;  // en Ampères
+    Millivolts voltage;
+    Milliamps current;
+};
+
+/**
+ * @brief Source des données rafraîchies par la synchronisation.
+ */
+enum class SyncMode : uint8_t {
+    Volatile,   // registres d'état, PDO, DPM_PDO_NUMB et RDO (3 lectures en rafale)
+    Nvm,        // relecture complète de la NVM (mode test FTP)
+};
+
+/**
+ * @brief Durée et nombre des synchronisations.
+ */
+struct SyncStats {
+    uint32_t count = 0;
+    uint32_t errors = 0;
+    uint32_t last_us = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+};
+
+/**
+ * @brief Copie des registres volatiles lus lors de la dernière synchronisation.
+ */
+struct VolatileRegs {
+    uint8_t alert_status = 0;    // ALERT_STATUS_1
+    uint8_t alert_mask = 0;      // ALERT_STATUS_1_MASK
+    uint8_t port_status[2] = {}; // PORT_STATUS_0, PORT_STATUS_1
+    uint8_t pdo_numb = 0;        // DPM_PDO_NUMB
+    uint32_t pdo[3] = {};        // DPM_SNK_PDO1..3
+    uint32_t rdo = 0;            // RDO_REG_STATUS
+};
+
+/**
+ * @brief État publié par le driver, copié de façon cohérente par les lecteurs.
+ */
+struct Snapshot {
+    uint32_t generation = 0;     // incrémenté à chaque publication
+    int64_t timestamp_us = 0;
+    bool available = false;
+    PDO pdos[3] = {};            // PDO de la NVM (dernière lecture ou programmation)
+    PDO active_pdos[3] = {};     // PDO volatils en vigueur (DPM_SNK_PDO1..3)
+    uint8_t sector[5][8] = {};
+    VolatileRegs regs;
+    SourceCapabilities source;
+};
+
+/**
+ * @brief Détection de la puce absente : sondage à intervalle croissant.
+ */
+struct DetectConfig {
+    uint32_t initial_ms = 10;           // intervalle après le premier ping sans réponse
+    uint32_t max_ms = 10000;            // plafond du recul exponentiel
+    bool alert_trigger = true;          // un front ALERT pendant l'absence relance le sondage rapide
+};
+
+/**
+ * @brief Compteurs de détection et délai avant le premier état complet.
+ */
+struct DetectStats {
+    uint32_t probes = 0;                // pings sans réponse
+    uint32_t attaches = 0;
+    uint32_t attach_failures = 0;       // ping réussi, synchronisation initiale en échec
+    uint32_t time_to_first_sync_us = 0; // création du driver -> premier état publié, 0 = pas encore
+    uint32_t last_ready_us = 0;         // dernier ping réussi -> état publié
+};
+
+/**
+ * @brief Latences d'une renégociation, par phase.
+ *
+ * Écriture PDO -> commande SOFT_RESET -> première alerte -> contrat établi (nouveau
+ * RDO lu, ou PS_RDY reçu pour un contrat identique au précédent).
+ */
+struct RenegotiationStats {
+    LatencyStats pdo_to_reset;
+    LatencyStats reset_to_alert;
+    LatencyStats alert_to_rdo;
+    LatencyStats total;             // écriture PDO (ou SOFT_RESET seul) -> contrat établi
+    uint32_t started = 0;
+    uint32_t same_contract = 0;     // PS_RDY reçu, RDO inchangé
+    uint32_t timeouts = 0;          // ni nouveau RDO ni PS_RDY dans le délai imparti
+};
+
+/**
+ * @brief Compteurs de trafic I2C du driver.
+ */
+struct BusStats {
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+    uint32_t errors = 0;
+};
+
+/**
+ * @brief Statistiques de latence d'un opcode FTP (déclenchement -> fin observée).
+ *
+ * L'histogramme est logarithmique : le seau k compte les latences dans
+ * [2^k, 2^(k+1)) µs, le dernier seau regroupe tout ce qui dépasse.
+ */
+struct FtpStats {
+    static constexpr int Buckets = 16;
+
+    uint32_t count = 0;
+    uint32_t timeouts = 0;
+    uint32_t polls = 0;
+    uint32_t min_us = UINT32_MAX;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+    uint32_t expected_us = 0;   // estimation adaptative utilisée pour espacer les lectures
+    uint32_t histogram[Buckets] = {};
+};
+
+/**
+ * @brief Programmation NVM vérifiée : relecture de chaque secteur et reprise des seuls échecs.
+ */
+struct ProgramConfig {
+    bool verify = false;            // relecture en rafale après chaque PROG_SECTOR
+    uint8_t retries = 2;            // reprises (effacement + programmation) par secteur en échec
+};
+
+/**
+ * @brief Programmation et vérification d'un secteur NVM.
+ */
+struct SectorProgramStats {
+    uint32_t programs = 0;          // programmations, reprises comprises
+    uint32_t verify_failures = 0;   // relectures différentes de l'image
+    uint32_t retries = 0;
+    uint32_t unrecovered = 0;       // budget de reprises épuisé
+    uint32_t last_program_us = 0;   // WRITE_PL + PROG_SECTOR
+    uint32_t max_program_us = 0;
+    uint32_t last_verify_us = 0;    // READ + lecture RW_BUFFER
+    uint32_t max_verify_us = 0;
+};
+
+/**
+ * @brief Bilan d'un commit de configuration NVM.
+ *
+ * Les économies sont estimées par rapport à une écriture par champ
+ * (lecture NVM + effacement + programmation d'un secteur à chaque fois).
+ */
+struct CommitReport {
+    uint16_t edits = 0;
+    uint8_t sectors = 0;            // secteurs effacés et reprogrammés
+    uint32_t transactions = 0;      // transactions I2C (lecture initiale + commit)
+    uint32_t elapsed_us = 0;
+    uint32_t saved_transactions = 0;
+    uint32_t saved_us = 0;
+};
+
+/**
+ * @brief Contention sur la garde de séquence (FTP, programmation NVM, PDO + SOFT_RESET).
+ */
+struct GuardStats {
+    uint32_t acquisitions = 0;      // séquences de plus haut niveau
+    uint32_t contended = 0;         // attentes derrière une autre tâche
+    uint64_t total_wait_us = 0;
+    uint32_t max_wait_us = 0;
+    uint32_t max_hold_us = 0;
+    char last_blocker[16] = {};     // détenteur lors de la dernière attente
+    char holder[16] = {};           // détenteur actuel ("" si libre)
+};
+
+class STUSB4500;
+
+/**
+ * @brief Transaction de configuration NVM.
+ *
+ * Les modifications sont appliquées sur une copie de l'image NVM lue à
+ * l'ouverture, puis écrites par commit() avec un seul enter_write_mode()
+ * et une programmation par secteur modifié.
+ * La garde de séquence est détenue de l'ouverture à la destruction : la
+ * lecture-modification-écriture est atomique vis-à-vis de la tâche de
+ * synchronisation et des autres tâches. La transaction doit donc être
+ * ouverte, validée et détruite sur la même tâche.
+ */
+class ConfigTransaction {
+public:
+    ConfigTransaction& set_upper_voltage_limit(uint8_t pdo_numb, uint8_t value);
+    ConfigTransaction& set_lower_voltage_limit(uint8_t pdo_numb, uint8_t value);
+    ConfigTransaction& set_flex_current(float value);
+    ConfigTransaction& set_flex_current(Milliamps value);
+    ConfigTransaction& set_external_power(uint8_t value);
+    ConfigTransaction& set_usb_comm_capable(uint8_t value);
+    ConfigTransaction& set_config_ok_gpio(uint8_t value);
+    ConfigTransaction& set_gpio_ctrl(uint8_t value);
+    ConfigTransaction& set_power_above_5v_only(uint8_t value);
+    ConfigTransaction& set_req_src_current(uint8_t value);
+
+    uint8_t dirty_sectors() const { return dirty; }
+    uint16_t edit_count() const { return edits; }
+    esp_err_t commit(CommitReport* report = nullptr);
+
+    ConfigTransaction(const ConfigTransaction&) = delete;
+    ConfigTransaction& operator=(const ConfigTransaction&) = delete;
+    ~ConfigTransaction();
+
+private:
+    friend class STUSB4500;
+    explicit ConfigTransaction(STUSB4500& dev);
+
+    // Écriture d'un champ décrit dans stusb4500_fields.hpp (valeur physique)
+    template <typename Field>
+    void edit(int value);
+
+    STUSB4500& dev;
+    uint8_t image[5][8] = {};
+    uint8_t dirty = 0;
+    uint16_t edits = 0;
+    esp_err_t status = ESP_OK;
+    uint32_t read_transactions = 0;
+    uint32_t read_us = 0;
 };
 
 /**
@@ -19,33 +243,70 @@ struct PDO {
  */
 class STUSB4500 {
 public:
-    explicit STUSB4500(std::shared_ptr<I2CDevice> i2c);
+    /**
+     * @param start_task false si l'instance est pilotée par un DeviceManager
+     */
+    explicit STUSB4500(std::shared_ptr<I2CDevice> i2c, bool start_task = true);
     ~STUSB4500();
 
     // === Communication bas-niveau ===
     esp_err_t read(uint8_t reg, uint8_t* data, size_t len);
     esp_err_t write(uint8_t reg, const uint8_t* data, size_t len);
+    BusStats get_bus_stats() const;
+
+    // === Profilage I2C par API (CONFIG_STUSB4500_PROFILING, sinon compteurs nuls) ===
+    ApiProfile get_api_profile(ProfileApi api) const;
+    void reset_api_profiles();
 
     // === Contrôle PD ===
     esp_err_t soft_reset();
     esp_err_t read_pdo(uint8_t pdo_numb, uint32_t& out_pdo);
     esp_err_t write_pdo(uint8_t pdo_numb, uint32_t pdo_data);
+    // Table DPM_SNK_PDO1..3 (0x85-0x90) en une seule transaction ; write_pdos() écrit PDO1..count
+    esp_err_t read_pdos(uint32_t out_pdos[3]);
+    esp_err_t write_pdos(const uint32_t pdos[3], uint8_t count = 3);
+    esp_err_t read_pdos(SinkPdo out_pdos[3]);
+    esp_err_t write_pdos(const SinkPdo pdos[3], uint8_t count = 3);
+
+    // === Sélection de contrat ===
+    SourceCapabilities get_source_capabilities() const { return get_snapshot().source; }
+    esp_err_t apply_sink_pdos(const SinkPdoSet& set);
+    esp_err_t apply_power_policy(const PowerPolicy& policy);
+    RenegotiationStats get_renegotiation_stats() const;
+    void reset_renegotiation_stats();
 
     // === Gestion NVM ===
     esp_err_t read();
+    // PDO1..3 décrits par une image NVM (aucun accès bus)
+    static void decode_pdos(const uint8_t image[5][8], PDO out[3]);
     esp_err_t read_sectors();
     esp_err_t write_sectors(bool use_defaults = false);
     esp_err_t write_sector(uint8_t sector_num, const uint8_t* data);
     esp_err_t write_default_sectors(const uint8_t custom_sector[5][8]);
+    esp_err_t write_sectors_diff(const uint8_t image[5][8], uint8_t* programmed = nullptr);
+    esp_err_t program_sectors(const uint8_t image[5][8], uint8_t sectors);
     esp_err_t enter_write_mode(uint8_t erased_sectors);
     esp_err_t exit_test_mode();
+    FtpStats get_ftp_stats(uint8_t opcode) const;
+    void reset_ftp_stats();
+    void set_program_config(const ProgramConfig& config) { program_config = config; }
+    SectorProgramStats get_sector_program_stats(uint8_t sector_num) const;
+    void reset_sector_program_stats();
+
+    // === Profils NVM nommés (stusb4500_nvm_profiles.hpp) ===
+    // Secteurs à reprogrammer, d'après la dernière image NVM connue (aucun accès bus)
+    esp_err_t diff_nvm_profile(const NvmProfile& profile, uint8_t& sectors);
+    esp_err_t apply_nvm_profile(const NvmProfile& profile, uint8_t* programmed = nullptr);
 
     // === Accesseurs (lecture de configuration) ===
     float get_voltage(uint8_t pdo_numb);
     float get_current(uint8_t pdo_numb);
+    Millivolts get_voltage_mv(uint8_t pdo_numb);
+    Milliamps get_current_ma(uint8_t pdo_numb);
     uint8_t get_upper_voltage_limit(uint8_t pdo_numb);
     uint8_t get_lower_voltage_limit(uint8_t pdo_numb);
     float get_flex_current();
+    Milliamps get_flex_current_ma();
     uint8_t get_pdo_number();
     uint8_t get_external_power();
     uint8_t get_usb_comm_capable();
@@ -54,12 +315,18 @@ public:
     uint8_t get_power_above_5v_only();
     uint8_t get_req_src_current();
 
+    // === Transaction de configuration NVM ===
+    ConfigTransaction begin_config();
+
     // === Mutateurs (configuration) ===
     void set_voltage(uint8_t pdo_numb, float voltage);
     void set_current(uint8_t pdo_numb, float current);
+    void set_voltage(uint8_t pdo_numb, Millivolts voltage);
+    void set_current(uint8_t pdo_numb, Milliamps current);
     void set_upper_voltage_limit(uint8_t pdo_numb, uint8_t value);
     void set_lower_voltage_limit(uint8_t pdo_numb, uint8_t value);
     void set_flex_current(float value);
+    void set_flex_current(Milliamps value);
     void set_pdo_number(uint8_t value);
     void set_external_power(uint8_t value);
     void set_usb_comm_capable(uint8_t value);
@@ -69,31 +336,253 @@ public:
     void set_req_src_current(uint8_t value);
 
     // === Synchronisation automatique ===
+    esp_err_t configure_alert_pin(gpio_num_t gpio);
     static void IRAM_ATTR alert_isr_handler(void* arg);
     bool is_available() const { return available; }
+    // Attend la première synchronisation complète après détection (ESP_ERR_TIMEOUT sinon)
+    esp_err_t wait_until_ready(TickType_t timeout);
+    void set_detect_config(const DetectConfig& config) { detect_config = config; }
+    DetectStats get_detect_stats() const { return detect_stats; }
+    void set_sync_mode(SyncMode mode) { sync_mode = mode; }
+    SyncMode get_sync_mode() const { return sync_mode; }
+    esp_err_t sync_volatile();
+    // Une itération de la synchronisation (détection, commandes en file, relecture), pour
+    // une instance sans tâche pilotée par l'application ; jamais en parallèle d'une autre
+    TickType_t run_once(bool alert = false);
+    SyncStats get_sync_stats() const { return sync_stats; }
+    VolatileRegs get_volatile_regs() const { return get_snapshot().regs; }
+
+    // === Instantanés cohérents (lecture sans verrou) ===
+    Snapshot get_snapshot() const;
+    uint32_t get_generation() const { return generation.load(std::memory_order_acquire); }
+    bool wait_for_generation(uint32_t after, Snapshot& out, TickType_t timeout);
+
+    // === File de commandes asynchrones (exécutées par la tâche du driver) ===
+    static constexpr size_t CommandQueueDepth = 8;
+    std::expected<CommandTicket, esp_err_t> submit(const Command& cmd, CommandCallback done = {});
+    // ESP_ERR_NOT_FOUND : résultat déjà sorti de l'historique (16 dernières commandes)
+    CommandResult wait(CommandTicket ticket, TickType_t timeout);
+    CommandStats get_command_stats() const;
+
+    // === Sérialisation des séquences multi-registres ===
+    // Les lectures volatiles isolées n'attendent jamais la garde
+    GuardStats get_guard_stats() const;
+    void reset_guard_stats();
+
+    // === Télémétrie du contrat négocié (un seul consommateur) ===
+    static constexpr size_t TelemetryDepth = 32;
+    size_t drain_telemetry(ContractRecord* out, size_t max) { return telemetry.pop(out, max); }
+    size_t get_telemetry_pending() const { return telemetry.size(); }
+    uint32_t get_telemetry_dropped() const { return telemetry.dropped(); }
+
+    // === Abonnement aux événements (publiés par la synchronisation) ===
+    // Rappel exécuté sur la tâche de synchronisation, ou copie dans une file
+    // FreeRTOS d'éléments Event (envoi non bloquant, perte comptée si pleine)
+    static constexpr size_t MaxSubscribers = 8;
+    Subscription subscribe(EventCallback callback, uint32_t mask = AllEvents);
+    Subscription subscribe(QueueHandle_t queue, uint32_t mask = AllEvents);
+    void unsubscribe(Subscription subscription);
+    EventStats get_event_stats() const;
 
 private:
+    friend class ConfigTransaction;
+    friend class DeviceManager;
+    friend class SequenceGuard;
+    friend class StateLock;
+
+    // Bits transmis à service() : alerte en attente, commande ou réveil applicatif
+    static constexpr uint32_t NotifyAlert = 1u << 0;
+    static constexpr uint32_t NotifyCommand = 1u << 1;
+
     // === Interface bas-niveau ===
-    std::shared_ptr<I2CDevice> i2c_dev;
+    // Bus du moteur FTP : read()/write() du driver (statistiques, cache, profilage)
+    struct DriverBus {
+        STUSB4500* dev;
+        esp_err_t read(uint8_t reg, uint8_t* data, size_t len) { return dev->read(reg, data, len); }
+        esp_err_t write(uint8_t reg, const uint8_t* data, size_t len) { return dev->write(reg, data, len); }
+    };
+
+    std::shared_ptr<I2CDevice> i2c_dev; // possession uniquement
+    I2CDeviceBus bus;                   // accès sans copie du shared_ptr
+    FtpEngine<DriverBus> ftp{DriverBus{this}};
+    // Incrémentés par read()/write() depuis n'importe quelle tâche
+    std::atomic<uint32_t> bus_transactions{0};
+    std::atomic<uint32_t> bus_bytes{0};
+    std::atomic<uint32_t> bus_errors{0};
+#if CONFIG_STUSB4500_PROFILING
+    ApiProfile api_profiles[static_cast<size_t>(ProfileApi::Count)];
+    mutable portMUX_TYPE profile_lock = portMUX_INITIALIZER_UNLOCKED;
+    void profile_transaction(size_t len, esp_err_t err, uint32_t elapsed_us);
+#endif
 
     // === Données locales ===
     uint8_t sector[5][8] = {};
+    uint8_t nvm_image[5][8] = {};   // dernier contenu NVM lu ou programmé
+    bool nvm_image_valid = false;
+    FtpStats ftp_stats[8];          // indexé par opcode FTP
+    ProgramConfig program_config;
+    SectorProgramStats sector_program_stats[5];
+    // Découpage du dernier program_sectors() (bilan de ConfigTransaction::commit)
+    struct ProgramPhases {
+        uint32_t enter_tx = 0, program_tx = 0, exit_tx = 0;
+        uint32_t enter_us = 0, program_us = 0, exit_us = 0;
+    };
+    ProgramPhases last_program;
     PDO pdos[3];
+    VolatileRegs volatile_regs;
+    SourceCapabilities source_caps;
+
+    // === Cache des registres volatiles : alimenté par read()/write(), vidé sur alerte ou détache ===
+    // read()/write() l'alimentent depuis n'importe quelle tâche : accès sous shadow_lock
+    struct RegisterShadow {
+        uint32_t pdo[3] = {};       // DPM_SNK_PDO1..3
+        uint8_t pdo_numb = 0;       // DPM_PDO_NUMB
+        uint8_t valid = 0;          // bits 0..2 : PDO1..3, bit 3 : DPM_PDO_NUMB
+        uint32_t epoch = 0;         // incrémenté à chaque écriture ou invalidation
+    };
+    RegisterShadow shadow;
+    mutable portMUX_TYPE shadow_lock = portMUX_INITIALIZER_UNLOCKED;
 
     // === Sync & alert ===
     gpio_num_t alert_gpio = GPIO_NUM_NC;
-    volatile bool alert_triggered = false;
     bool alert_enabled = false;
     bool available = false;
     uint32_t last_sync_ms = 0;
     uint32_t sync_interval_ms = 60000;
+    SyncMode sync_mode = SyncMode::Volatile;
+    SyncStats sync_stats;
     TaskHandle_t sync_task_handle = nullptr;
+    DetectConfig detect_config;
+    DetectStats detect_stats;
+    uint32_t probe_interval_ms = 0;             // 0 : prochain échec au rythme initial
+    int64_t created_us = 0;
+    TaskHandle_t volatile notify_task = nullptr;   // tâche réveillée par l'ISR ALERT
+    uint32_t notify_bits = NotifyAlert;             // envoyés par l'ISR ALERT
+    uint32_t command_bits = NotifyCommand;          // envoyés par submit() et la renégociation
+    std::atomic<bool> polled{false};                // run_once() appelé : file servie sans tâche
+
+    // === Instantanés : double tampon + numéro de séquence par tampon ===
+    struct SnapshotSlot {
+        std::atomic<uint32_t> seq{0};   // impair pendant l'écriture
+        Snapshot data;
+    };
+    SnapshotSlot snapshots[2];
+    std::atomic<uint8_t> published_slot{0};
+    std::atomic<uint32_t> generation{0};
+    portMUX_TYPE publish_lock = portMUX_INITIALIZER_UNLOCKED;
+    EventGroupHandle_t snapshot_events = nullptr;
+
+    // === Télémétrie : produite par la tâche de synchronisation uniquement ===
+    SpscRing<ContractRecord, TelemetryDepth> telemetry;
+
+    // === Événements : abonnés protégés par un mutex récursif (rappels sous verrou) ===
+    struct Subscriber {
+        uint32_t id = 0;            // 0 = emplacement libre
+        uint32_t mask = 0;          // 0 après unsubscribe() pendant une diffusion
+        EventCallback callback;
+        QueueHandle_t queue = nullptr;
+        bool released = false;      // libéré à la fin de la diffusion en cours
+    };
+    Subscriber subscribers[MaxSubscribers];
+    uint32_t next_subscription_id = 1;
+    uint32_t publish_depth = 0;     // diffusions imbriquées (rappel qui publie)
+    EventStats event_stats;
+    SemaphoreHandle_t event_mutex = nullptr;
+    ContractRecord published_state;     // état volatil au dernier événement
+    uint8_t published_drift = 0;
+
+    // === File de commandes : FIFO circulaire protégée par un mutex récursif ===
+    static constexpr size_t CommandMaxMerged = 4;
+    static constexpr size_t CommandResults = 16;
+    struct QueuedCommand {
+        Command cmd;
+        uint32_t ids[CommandMaxMerged] = {};
+        CommandCallback callbacks[CommandMaxMerged];
+        uint8_t waiters = 0;
+    };
+    struct CompletedCommand {
+        uint32_t id = 0;
+        esp_err_t err = ESP_OK;
+    };
+    QueuedCommand command_queue[CommandQueueDepth];
+    size_t command_head = 0;
+    size_t command_count = 0;
+    size_t command_busy = 0;        // commandes en tête en cours d'exécution (non fusionnables)
+    CompletedCommand command_results[CommandResults];
+    size_t command_result_next = 0;
+    uint32_t next_command_id = 1;
+    CommandStats command_stats;
+    SemaphoreHandle_t command_mutex = nullptr;
+
+    // === Garde de séquence ===
+    SemaphoreHandle_t sequence_mutex = nullptr;     // récursif
+    TaskHandle_t sequence_holder = nullptr;         // protégé par guard_lock
+    uint32_t sequence_depth = 0;                    // modifié par le seul détenteur
+    int64_t sequence_since_us = 0;
+    GuardStats guard_stats;
+    mutable portMUX_TYPE guard_lock = portMUX_INITIALIZER_UNLOCKED;
+    void acquire_sequence();
+    void release_sequence();
+
+    // === Verrou d'état : état publié (NVM en cache, registres volatils, capacités source) ===
+    // Tenu le temps d'une copie, jamais pendant un échange I2C : un écrivain NVM
+    // détient aussi la garde de séquence, un lecteur se contente de l'un des deux
+    SemaphoreHandle_t state_mutex = nullptr;        // récursif
+
+    // === Suivi de renégociation (horodatages µs, 32 bits) ===
+    static constexpr size_t RenegSamples = 64;
+    struct RenegTrace {
+        uint32_t start_us = 0;      // écriture PDO, ou SOFT_RESET sans écriture préalable
+        uint32_t reset_us = 0;
+        uint32_t alert_us = 0;
+        uint32_t rdo_before = 0;
+        bool pdo_written = false;
+        bool alert_seen = false;
+    };
+    RenegTrace reneg;
+    std::atomic<bool> reneg_pending{false};
+    std::atomic<uint32_t> alert_stamp_us{0};    // horodaté dans l'ISR ALERT
+    LatencyRecorder<RenegSamples> reneg_phases[4];
+    uint32_t reneg_started = 0;
+    uint32_t reneg_same_contract = 0;
+    uint32_t reneg_timeouts = 0;
+    mutable portMUX_TYPE reneg_lock = portMUX_INITIALIZER_UNLOCKED;
 
     // === Logique interne ===
+    void publish_snapshot();
+    esp_err_t ftp_unlock();
+    esp_err_t ftp_exec(uint8_t ctrl1, uint8_t sector_num);
+    esp_err_t ftp_wait(uint8_t opcode);
+    esp_err_t verify_sector(uint8_t sector_num, const uint8_t* expected, bool& match);
+    esp_err_t abort_program(esp_err_t err, const char* what);
     void start_sync_task();
     static void sync_task(void* arg);
+    TickType_t service(uint32_t events);
+    void set_notifier(TaskHandle_t task, uint32_t alert_bits, uint32_t wake_bits);
     esp_err_t sync_from_device();
-    esp_err_t configure_alert_pin(gpio_num_t gpio);
+    void mark_ready(int64_t detected_us);
+    void record_contract(const VolatileRegs& regs);
+    Subscription add_subscriber(Subscriber sub);
+    void publish_event(Event& event);
+    void publish_changes();
+    void check_nvm_drift();
+    esp_err_t capture_source_capabilities(SourceCapabilities& caps, bool& ps_ready);
+    void mark_pdo_write();
+    uint32_t shadow_epoch() const;
+    void shadow_store(uint8_t reg, const uint8_t* data, size_t len, const uint32_t* read_epoch);
+    bool shadow_pdos(uint32_t out[3]) const;
+    bool shadow_pdo_numb(uint8_t& numb) const;
+    void invalidate_shadow();
+    void run_commands();
+    esp_err_t execute_command(const Command& cmd);
+    bool command_pending(uint32_t id) const;
+    esp_err_t apply_voltage(uint8_t pdo_numb, Millivolts voltage);
+    esp_err_t apply_current(uint8_t pdo_numb, Milliamps current);
+    esp_err_t apply_pdo_number(uint8_t value);
+    void begin_renegotiation();
+    void track_renegotiation(const VolatileRegs& regs, bool ps_ready);
+    esp_err_t arm_alerts();
+    TickType_t next_wait(uint32_t now) const;
 };
 
 } // namespace stusb4500
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "I2CDevice.hpp"
+#include "STUSB4500_register_map.h"
+
+namespace stusb4500 {
+
+/**
+ * @brief Politique de bus : accès registre résolus à la compilation.
+ *
+ * Tout type offrant read()/write() au format d'I2CDevice convient ; les
+ * appels sont inlinés dans FtpEngine au lieu de passer par la vtable.
+ */
+template <typename Bus>
+concept BusPolicy = requires(Bus& bus, uint8_t reg, uint8_t* data, const uint8_t* cdata, size_t len) {
+    { bus.read(reg, data, len) } -> std::same_as<esp_err_t>;
+    { bus.write(reg, cdata, len) } -> std::same_as<esp_err_t>;
+};
+
+/**
+ * @brief Bus historique : appel virtuel sur un I2CDevice (pointeur non possédant,
+ * aucun trafic de compteur de références).
+ */
+struct I2CDeviceBus {
+    I2CDevice* dev = nullptr;
+
+    esp_err_t read(uint8_t reg, uint8_t* data, size_t len) { return dev->read(reg, data, len); }
+    esp_err_t write(uint8_t reg, const uint8_t* data, size_t len) { return dev->write(reg, data, len); }
+};
+
+/**
+ * @brief Séquences FTP (accès NVM) du STUSB4500 sur un bus quelconque.
+ *
+ * Entièrement dans l'en-tête : avec un bus concret, les centaines d'accès
+ * d'un octet d'une lecture ou programmation NVM sont inlinés. STUSB4500
+ * l'instancie sur son propre bus (statistiques, cache, profilage) et y
+ * ajoute l'attente adaptative ; exec() suffit pour un usage autonome
+ * (outil de production, banc sur hôte).
+ */
+template <BusPolicy Bus>
+class FtpEngine {
+public:
+    static constexpr size_t SectorCount = 5;
+    static constexpr size_t SectorSize = 8;
+
+    explicit FtpEngine(Bus bus) : bus(bus) {}
+
+    Bus& get_bus() { return bus; }
+
+    // Mot de passe puis reset du contrôleur (registres contigus) en une écriture
+    esp_err_t unlock() {
+        const uint8_t buffer[2] = {FTP_CUST_PASSWORD, 0x00};
+        return bus.write(FTP_CUST_PASSWORD_REG, buffer, sizeof(buffer));
+    }
+
+    // Sortie du mode test : reset du contrôleur et effacement du mot de passe
+    esp_err_t lock() {
+        uint8_t buffer[1] = {FTP_CUST_RST_N};
+        esp_err_t err = bus.write(FTP_CTRL_0, buffer, 1);
+        if (err != ESP_OK)
+            return err;
+        buffer[0] = 0x00;
+        return bus.write(FTP_CUST_PASSWORD_REG, buffer, 1);
+    }
+
+    // FTP_CTRL_0 (PWR | RST_N) et FTP_CTRL_1 (opcode) en une écriture, puis REQ
+    esp_err_t request(uint8_t ctrl1, uint8_t sector_num) {
+        const uint8_t ctrl[2] = {FTP_CUST_PWR | FTP_CUST_RST_N, ctrl1};
+        esp_err_t err = bus.write(FTP_CTRL_0, ctrl, sizeof(ctrl));
+        if (err != ESP_OK)
+            return err;
+        const uint8_t req = (sector_num & FTP_CUST_SECT) | FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
+        return bus.write(FTP_CTRL_0, &req, 1);
+    }
+
+    esp_err_t busy(bool& pending) {
+        uint8_t ctrl0 = 0;
+        esp_err_t err = bus.read(FTP_CTRL_0, &ctrl0, 1);
+        pending = (ctrl0 & FTP_CUST_REQ) != 0;
+        return err;
+    }
+
+    esp_err_t load(const uint8_t* data, size_t len) { return bus.write(RW_BUFFER, data, len); }
+    esp_err_t fetch(uint8_t* data, size_t len) { return bus.read(RW_BUFFER, data, len); }
+
+    // Déclenchement et scrutation sans délai, bornée à max_polls lectures
+    esp_err_t exec(uint8_t ctrl1, uint8_t sector_num, uint32_t max_polls = 1000) {
+        esp_err_t err = request(ctrl1, sector_num);
+        for (uint32_t i = 0; err == ESP_OK && i < max_polls; ++i) {
+            bool pending = true;
+            err = busy(pending);
+            if (err == ESP_OK && !pending)
+                return ESP_OK;
+        }
+        return err != ESP_OK ? err : ESP_ERR_TIMEOUT;
+    }
+
+    // Lecture complète de la NVM (mode test ouvert puis refermé)
+    esp_err_t read_sectors(uint8_t image[5][8]) {
+        esp_err_t err = unlock();
+        for (uint8_t i = 0; err == ESP_OK && i < SectorCount; ++i) {
+            err = exec(READ, i);
+            if (err == ESP_OK)
+                err = fetch(image[i], SectorSize);
+        }
+        esp_err_t closed = lock();
+        return err != ESP_OK ? err : closed;
+    }
+
+private:
+    Bus bus;
+};
+
+} // namespace stusb4500
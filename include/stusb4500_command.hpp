@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include "esp_err.h"
+#include "stusb4500_policy.hpp"
+
+namespace stusb4500 {
+
+using CommandResult = std::expected<void, esp_err_t>;
+using CommandCallback = std::function<void(CommandResult)>;
+
+/**
+ * @brief Commande exécutée par la tâche du driver (file par périphérique).
+ *
+ * Les commandes NVM consécutives sont regroupées en une seule transaction
+ * (un seul effacement/programmation). Une commande de même cible encore en
+ * attente est remplacée par la plus récente, sauf si une commande "barrière"
+ * (SOFT_RESET, jeu de PDO, politique) a été mise en file entre les deux.
+ */
+struct Command {
+    enum class Kind : uint8_t {
+        // PD (registres volatiles)
+        SetVoltage,
+        SetCurrent,
+        SetPdoNumber,
+        SoftReset,
+        ApplySinkPdos,
+        ApplyPowerPolicy,
+        // NVM
+        UpperVoltageLimit,
+        LowerVoltageLimit,
+        FlexCurrent,
+        ExternalPower,
+        UsbCommCapable,
+        ConfigOkGpio,
+        GpioCtrl,
+        PowerAbove5vOnly,
+        ReqSrcCurrent,
+    };
+
+    Kind kind = Kind::SoftReset;
+    uint8_t pdo_numb = 0;
+    uint32_t value = 0;         // mV / mA pour tension et courants, valeur brute sinon
+    SinkPdoSet pdos;
+    PowerPolicy policy;
+
+    bool is_nvm() const { return kind >= Kind::UpperVoltageLimit; }
+    bool is_barrier() const {
+        return kind == Kind::SoftReset || kind == Kind::ApplySinkPdos || kind == Kind::ApplyPowerPolicy;
+    }
+    bool same_target(const Command& other) const {
+        return kind == other.kind && pdo_numb == other.pdo_numb;
+    }
+
+    // === Fabriques ===
+    static Command set_voltage(uint8_t pdo_numb, Millivolts voltage) { return make(Kind::SetVoltage, pdo_numb, voltage.value); }
+    static Command set_current(uint8_t pdo_numb, Milliamps current) { return make(Kind::SetCurrent, pdo_numb, current.value); }
+    static Command set_voltage(uint8_t pdo_numb, float voltage) { return set_voltage(pdo_numb, Millivolts::from_si(voltage)); }
+    static Command set_current(uint8_t pdo_numb, float current) { return set_current(pdo_numb, Milliamps::from_si(current)); }
+    static Command set_pdo_number(uint8_t value) { return make(Kind::SetPdoNumber, 0, value); }
+    static Command soft_reset() { return make(Kind::SoftReset, 0, 0); }
+    static Command apply_sink_pdos(const SinkPdoSet& set) {
+        Command c = make(Kind::ApplySinkPdos, 0, 0);
+        c.pdos = set;
+        return c;
+    }
+    static Command apply_power_policy(const PowerPolicy& policy) {
+        Command c = make(Kind::ApplyPowerPolicy, 0, 0);
+        c.policy = policy;
+        return c;
+    }
+    static Command set_upper_voltage_limit(uint8_t pdo_numb, uint8_t value) { return make(Kind::UpperVoltageLimit, pdo_numb, value); }
+    static Command set_lower_voltage_limit(uint8_t pdo_numb, uint8_t value) { return make(Kind::LowerVoltageLimit, pdo_numb, value); }
+    static Command set_flex_current(Milliamps value) { return make(Kind::FlexCurrent, 0, value.value); }
+    static Command set_flex_current(float value) { return set_flex_current(Milliamps::from_si(value)); }
+    static Command set_external_power(uint8_t value) { return make(Kind::ExternalPower, 0, value); }
+    static Command set_usb_comm_capable(uint8_t value) { return make(Kind::UsbCommCapable, 0, value); }
+    static Command set_config_ok_gpio(uint8_t value) { return make(Kind::ConfigOkGpio, 0, value); }
+    static Command set_gpio_ctrl(uint8_t value) { return make(Kind::GpioCtrl, 0, value); }
+    static Command set_power_above_5v_only(uint8_t value) { return make(Kind::PowerAbove5vOnly, 0, value); }
+    static Command set_req_src_current(uint8_t value) { return make(Kind::ReqSrcCurrent, 0, value); }
+
+private:
+    static Command make(Kind kind, uint8_t pdo_numb, uint32_t value) {
+        Command c;
+        c.kind = kind;
+        c.pdo_numb = pdo_numb;
+        c.value = value;
+        return c;
+    }
+};
+
+/**
+ * @brief Identifiant d'une commande soumise, à passer à STUSB4500::wait().
+ */
+struct CommandTicket {
+    uint32_t id = 0;
+};
+
+/**
+ * @brief Compteurs de la file de commandes.
+ */
+struct CommandStats {
+    uint32_t submitted = 0;
+    uint32_t merged = 0;        // fusionnées avec une commande en attente
+    uint32_t executed = 0;      // exécutions réelles (après fusion et regroupement NVM)
+    uint32_t nvm_commits = 0;
+    uint32_t rejected = 0;      // file pleine
+    uint32_t failed = 0;
+};
+
+} // namespace stusb4500
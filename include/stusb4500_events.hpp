@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "stusb4500_telemetry.hpp"
+
+namespace stusb4500 {
+
+enum class EventType : uint8_t {
+    Attached,           // puce détectée et synchronisée (after = état initial)
+    Detached,           // puce perdue (before = dernier état connu)
+    PdoChanged,         // DPM_PDO_NUMB ou DPM_SNK_PDO1..3 modifiés
+    ContractChanged,    // nouveau RDO négocié
+    NvmDrift,           // NVM différente de la configuration attendue
+};
+
+constexpr uint32_t event_bit(EventType type) { return 1u << static_cast<uint8_t>(type); }
+constexpr uint32_t AllEvents = 0x1F;
+
+/**
+ * @brief Événement publié par la synchronisation (tâche propre ou gestionnaire).
+ *
+ * before/after reprennent l'état volatil (PDO, RDO décodé) de part et d'autre
+ * du changement. Pour NvmDrift, l'avant/après porte sur la NVM : nvm_expected
+ * (default_sector_config) et nvm_actual (image lue) pour les secteurs de
+ * nvm_drift ; after donne le contrat en cours.
+ */
+struct Event {
+    EventType type = EventType::Attached;
+    int64_t timestamp_us = 0;
+    ContractRecord before;
+    ContractRecord after;
+    uint8_t nvm_drift = 0;              // masque SECTOR_x (NvmDrift)
+    uint8_t nvm_expected[5][8] = {};    // secteurs de nvm_drift seulement
+    uint8_t nvm_actual[5][8] = {};
+};
+
+// Appelé depuis la tâche de synchronisation : ne doit pas bloquer
+using EventCallback = std::function<void(const Event&)>;
+
+/**
+ * @brief Identifiant d'abonnement, à passer à STUSB4500::unsubscribe().
+ */
+struct Subscription {
+    uint32_t id = 0;
+    explicit operator bool() const { return id != 0; }
+};
+
+/**
+ * @brief Compteurs de diffusion des événements.
+ */
+struct EventStats {
+    uint32_t published = 0;
+    uint32_t delivered = 0;     // rappels exécutés + événements mis en file
+    uint32_t dropped = 0;       // file d'un abonné pleine
+};
+
+} // namespace stusb4500
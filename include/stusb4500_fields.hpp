@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace stusb4500::nvm {
+
+/**
+ * @brief Portion d'un champ NVM contenue dans un octet.
+ *
+ * Les bits de `Mask` dans sector[Sector][Byte] portent les bits du champ à
+ * partir de `ValueShift` (champ réparti sur plusieurs octets).
+ */
+template <uint8_t Sector, uint8_t Byte, uint8_t Mask, uint8_t ValueShift = 0>
+struct Part {
+    static constexpr uint8_t sector = Sector;
+    static constexpr uint8_t byte = Byte;
+    static constexpr uint8_t mask = Mask;
+    static constexpr uint8_t shift = std::countr_zero(Mask);
+    static constexpr uint8_t value_shift = ValueShift;
+
+    static constexpr uint16_t extract(const uint8_t s[5][8]) {
+        return static_cast<uint16_t>(((s[Sector][Byte] & Mask) >> shift) << ValueShift);
+    }
+
+    static constexpr uint8_t place(uint16_t raw) {
+        return static_cast<uint8_t>(((raw >> ValueShift) << shift) & Mask);
+    }
+};
+
+/**
+ * @brief Descripteur de champ NVM : valeur physique = brut * Scale + Offset.
+ */
+template <int Scale, int Offset, typename... Parts>
+struct Field {
+    static constexpr size_t part_count = sizeof...(Parts);
+    static constexpr uint8_t sectors = ((1u << Parts::sector) | ...);
+    static constexpr uint16_t raw_max = static_cast<uint16_t>(
+        ((static_cast<uint32_t>(Parts::mask >> Parts::shift) << Parts::value_shift) | ...));
+
+    static constexpr uint16_t get_raw(const uint8_t s[5][8]) {
+        return (Parts::extract(s) | ...);
+    }
+
+    static constexpr void set_raw(uint8_t s[5][8], uint16_t raw) {
+        ((s[Parts::sector][Parts::byte] =
+              static_cast<uint8_t>((s[Parts::sector][Parts::byte] & ~Parts::mask) | Parts::place(raw))),
+         ...);
+    }
+
+    static constexpr int decode(uint16_t raw) { return raw * Scale + Offset; }
+
+    static constexpr uint16_t encode(int value) {
+        int raw = (value - Offset + Scale / 2) / Scale; // au pas le plus proche
+        if (raw < 0)
+            raw = 0;
+        if (raw > raw_max)
+            raw = raw_max;
+        return static_cast<uint16_t>(raw);
+    }
+};
+
+template <typename F>
+constexpr int get(const uint8_t s[5][8]) {
+    return F::decode(F::get_raw(s));
+}
+
+template <typename F>
+constexpr void set(uint8_t s[5][8], int value) {
+    F::set_raw(s, F::encode(value));
+}
+
+namespace detail {
+
+template <typename>
+using value_of = int;
+
+struct PartDesc {
+    uint8_t field;   // index du champ dans le lot
+    uint8_t sector;
+    uint8_t byte;
+    uint8_t mask;
+};
+
+template <size_t Index, int Scale, int Offset, typename... Parts>
+constexpr void collect(std::array<PartDesc, 32>& out, size_t& n, const Field<Scale, Offset, Parts...>*) {
+    ((out[n++] = PartDesc{static_cast<uint8_t>(Index), Parts::sector, Parts::byte, Parts::mask}), ...);
+}
+
+template <typename... Fields, size_t... I>
+constexpr auto all_parts(std::index_sequence<I...>) {
+    std::array<PartDesc, 32> out{};
+    size_t n = 0;
+    (collect<I>(out, n, static_cast<Fields*>(nullptr)), ...);
+    return std::pair{out, n};
+}
+
+// Octets distincts touchés par un lot, avec l'union des masques
+template <typename... Fields>
+constexpr auto merged_bytes() {
+    constexpr auto parts = all_parts<Fields...>(std::index_sequence_for<Fields...>{});
+    std::array<PartDesc, 32> out{};
+    size_t n = 0;
+    for (size_t i = 0; i < parts.second; ++i) {
+        const PartDesc& p = parts.first[i];
+        size_t j = 0;
+        while (j < n && !(out[j].sector == p.sector && out[j].byte == p.byte))
+            ++j;
+        if (j == n)
+            out[n++] = PartDesc{0, p.sector, p.byte, 0};
+        out[j].mask |= p.mask;
+    }
+    return std::pair{out, n};
+}
+
+template <typename F>
+constexpr uint8_t contribution(uint8_t sector, uint8_t byte, uint16_t raw) {
+    return [&]<int Scale, int Offset, typename... Parts>(const Field<Scale, Offset, Parts...>*) {
+        uint8_t acc = 0;
+        ((acc |= (Parts::sector == sector && Parts::byte == byte) ? Parts::place(raw) : 0), ...);
+        return acc;
+    }(static_cast<F*>(nullptr));
+}
+
+} // namespace detail
+
+/**
+ * @brief Écrit plusieurs champs avec une seule lecture-modification-écriture par octet.
+ *
+ * set_fields<GpioCtrl, ReqSrcCurrent>(sector, 1, 1);
+ */
+template <typename... Fields>
+constexpr void set_fields(uint8_t s[5][8], detail::value_of<Fields>... values)
+{
+    constexpr auto bytes = detail::merged_bytes<Fields...>();
+    const uint16_t raws[] = {Fields::encode(values)...};
+
+    [&]<size_t... B>(std::index_sequence<B...>) {
+        ([&] {
+            constexpr detail::PartDesc b = bytes.first[B];
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                uint8_t acc = (detail::contribution<Fields>(b.sector, b.byte, raws[I]) | ...);
+                s[b.sector][b.byte] = static_cast<uint8_t>((s[b.sector][b.byte] & ~b.mask) | acc);
+            }(std::index_sequence_for<Fields...>{});
+        }(), ...);
+    }(std::make_index_sequence<bytes.second>{});
+}
+
+// Masque SECTOR_x des secteurs touchés par un lot de champs
+template <typename... Fields>
+constexpr uint8_t sectors_of() {
+    return (Fields::sectors | ...);
+}
+
+// === Carte des champs NVM (5 secteurs x 8 octets) ===
+using GpioCtrl          = Field<1, 0, Part<1, 0, 0x30>>;
+using UsbCommCapable    = Field<1, 0, Part<3, 2, 0x01>>;
+using SnkPdoNumb        = Field<1, 0, Part<3, 2, 0x06>>;
+using ExternalPower     = Field<1, 0, Part<3, 2, 0x08>>;
+using Pdo1Current       = Field<1, 0, Part<3, 2, 0xF0>>;   // code courant 4 bits
+using Pdo1UpperLimit    = Field<1, 5, Part<3, 3, 0xF0>>;   // en %
+using Pdo2Current       = Field<1, 0, Part<3, 4, 0x0F>>;
+using Pdo2LowerLimit    = Field<1, 5, Part<3, 4, 0xF0>>;
+using Pdo2UpperLimit    = Field<1, 5, Part<3, 5, 0x0F>>;
+using Pdo3Current       = Field<1, 0, Part<3, 5, 0xF0>>;
+using Pdo3LowerLimit    = Field<1, 5, Part<3, 6, 0x0F>>;
+using Pdo3UpperLimit    = Field<1, 5, Part<3, 6, 0xF0>>;
+using Pdo2Voltage       = Field<50, 0, Part<4, 0, 0xC0, 0>, Part<4, 1, 0xFF, 2>>;  // en mV
+using Pdo3Voltage       = Field<50, 0, Part<4, 2, 0xFF, 0>, Part<4, 3, 0x03, 8>>;  // en mV
+using FlexCurrent       = Field<10, 0, Part<4, 3, 0xFC, 0>, Part<4, 4, 0x0F, 6>>;  // en mA
+using ConfigOkGpio      = Field<1, 0, Part<4, 4, 0x60>>;
+using PowerAbove5vOnly  = Field<1, 0, Part<4, 6, 0x08>>;
+using ReqSrcCurrent     = Field<1, 0, Part<4, 6, 0x10>>;
+
+} // namespace stusb4500::nvm
@@ -22,7 +22,83 @@ namespace stusb4500 {
 constexpr int SectorCount = 5;
 constexpr int SectorSize = 8;
 
+// Publication d'instantanés
+constexpr uint32_t SnapshotPublishedBit = 1u << 0;
+constexpr uint32_t CommandDoneBit = 1u << 1;
+constexpr uint32_t ReadyBit = 1u << 2;          // niveau : présent et synchronisé
+constexpr TickType_t SnapshotWaitSlice = pdMS_TO_TICKS(10);
+
+// Alertes démasquées : détection CC (attache/détache) et messages PD
+constexpr uint8_t AlertMask = static_cast<uint8_t>(~(CC_DETECTION_STATUS_AL | PRT_STATUS_AL));
+
+// Attente FTP : délai maximal et estimation initiale par famille d'opcodes (µs)
+constexpr uint32_t FtpShortTimeoutUs = 10000;    // READ, WRITE_PL, WRITE_SER
+constexpr uint32_t FtpLongTimeoutUs = 500000;    // SOFT_PROG_SECTOR, ERASE_SECTOR, PROG_SECTOR
+constexpr uint32_t FtpShortInitialUs = 50;
+constexpr uint32_t FtpLongInitialUs = 2000;
+constexpr uint32_t FtpMaxBusyWaitUs = 500;      // opérations courtes : au-delà, sommeil d'un tick
+
+inline bool ftp_is_long_op(uint8_t opcode) {
+    return opcode == SOFT_PROG_SECTOR || opcode == ERASE_SECTOR || opcode == PROG_SECTOR;
+}
+
+// Renégociation : scrutation sans broche ALERT et délai maximal d'observation du nouveau contrat
+constexpr uint32_t RenegPollMs = 5;
+constexpr uint32_t RenegTimeoutUs = 1000000;
+
+// === Garde de séquence ===
+/**
+ * @brief Détient la garde de séquence du périphérique pour la portée courante.
+ *
+ * Récursive : une séquence peut en imbriquer d'autres sur la même tâche
+ * (commit -> enter_write_mode -> ...). Seul le niveau externe est compté.
+ */
+class SequenceGuard {
+public:
+    explicit SequenceGuard(STUSB4500& dev) : dev(dev) { dev.acquire_sequence(); }
+    ~SequenceGuard() { dev.release_sequence(); }
+
+    SequenceGuard(const SequenceGuard&) = delete;
+    SequenceGuard& operator=(const SequenceGuard&) = delete;
+
+private:
+    STUSB4500& dev;
+};
+
+/**
+ * @brief Détient le verrou d'état du périphérique pour la portée courante.
+ *
+ * Court : protège la mise à jour de l'état publié et sa copie dans l'instantané,
+ * sans attendre une séquence NVM en cours sur une autre tâche.
+ */
+class StateLock {
+public:
+    explicit StateLock(STUSB4500& dev) : dev(dev) { xSemaphoreTakeRecursive(dev.state_mutex, portMAX_DELAY); }
+    ~StateLock() { xSemaphoreGiveRecursive(dev.state_mutex); }
+
+    StateLock(const StateLock&) = delete;
+    StateLock& operator=(const StateLock&) = delete;
+
+private:
+    STUSB4500& dev;
+};
+
 // === Utilitaires internes ===
+inline uint32_t le32(const uint8_t* b) {
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+// RDO : position d'objet bits [30:28], courant opérationnel [19:10], max [9:0] (10 mA)
+inline uint8_t rdo_object_position(uint32_t rdo) { return (rdo >> 28) & 0x07; }
+inline uint16_t rdo_operating_ma(uint32_t rdo) { return ((rdo >> 10) & 0x3FF) * 10; }
+inline uint16_t rdo_max_ma(uint32_t rdo) { return (rdo & 0x3FF) * 10; }
+
+// Cache des registres volatiles : bit de validité de DPM_PDO_NUMB (PDO1..3 : bits 0..2)
+constexpr uint8_t ShadowPdoNumb = 1u << 3;
+
+// PORT_STATUS_1 : bit 0 = ATTACH
+constexpr uint8_t PortStatusAttach = 0x01;
+
 inline bool compare_sector(const uint8_t a[5][8], const uint8_t b[5][8]) {
     for (int i = 0; i < SectorCount; ++i) {
         for (int j = 0; j < SectorSize; ++j) {
@@ -32,4 +108,18 @@ inline bool compare_sector(const uint8_t a[5][8], const uint8_t b[5][8]) {
     return true;
 }
 
+// Masque SECTOR_x des secteurs qui diffèrent entre deux images
+inline uint8_t dirty_sector_mask(const uint8_t a[5][8], const uint8_t b[5][8]) {
+    uint8_t mask = 0;
+    for (int i = 0; i < SectorCount; ++i) {
+        for (int j = 0; j < SectorSize; ++j) {
+            if (a[i][j] != b[i][j]) {
+                mask |= 1 << i;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
 } // namespace stusb4500
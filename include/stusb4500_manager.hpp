@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "stusb4500.hpp"
+
+namespace stusb4500 {
+
+/**
+ * @brief Paramètres de la tâche de service d'un DeviceManager.
+ */
+struct ManagerConfig {
+    const char* task_name = "stusb4500_mgr";
+    uint32_t stack_size = 4096;
+    UBaseType_t priority = 5;
+    BaseType_t core = APP_CPU_NUM;
+};
+
+/**
+ * @brief Latence de service (détection, synchronisation, alerte) d'un périphérique.
+ */
+struct ServiceStats {
+    uint32_t services = 0;
+    uint32_t alerts = 0;
+    uint32_t last_us = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+};
+
+/**
+ * @brief Pilote plusieurs STUSB4500 depuis une seule tâche (typiquement une par bus I2C).
+ *
+ * Les instances doivent être construites avec start_task = false et enregistrées
+ * avant start(). Chaque instance reçoit deux bits de notification : l'ISR ALERT
+ * (bit i) et les commandes (bit 16 + i) réveillent directement la tâche du
+ * gestionnaire, qui ne sert que l'instance concernée.
+ */
+class DeviceManager {
+public:
+    static constexpr size_t MaxDevices = 16; // bits d'alerte et de commande par instance
+
+    explicit DeviceManager(const ManagerConfig& config = {});
+    ~DeviceManager();
+
+    esp_err_t add(STUSB4500& dev);
+    esp_err_t start();
+
+    size_t size() const { return entries.size(); }
+    ServiceStats get_service_stats(size_t index) const;
+    void reset_service_stats();
+
+private:
+    struct Entry {
+        STUSB4500* dev;
+        TickType_t due;
+        ServiceStats stats;
+    };
+
+    ManagerConfig config;
+    std::vector<Entry> entries;
+    TaskHandle_t task_handle = nullptr;
+
+    static void task(void* arg);
+    void run();
+};
+
+} // namespace stusb4500
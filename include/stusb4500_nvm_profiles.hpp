@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "esp_err.h"
+
+namespace stusb4500 {
+
+/**
+ * @brief Image NVM complète (5 secteurs x 8 octets) associée à un nom.
+ *
+ * Le checksum (CRC-32 du nom et de l'image) est calculé à l'ajout dans le
+ * magasin et vérifié au chargement comme avant toute programmation.
+ */
+struct NvmProfile {
+    static constexpr size_t MaxName = 15;
+
+    char name[MaxName + 1] = {};
+    uint8_t image[5][8] = {};
+    uint32_t checksum = 0;
+
+    uint32_t compute_checksum() const;
+    bool valid() const { return checksum == compute_checksum(); }
+};
+
+// Masque SECTOR_x des secteurs qui diffèrent entre un profil et une image (sans accès bus)
+uint8_t profile_diff(const NvmProfile& profile, const uint8_t image[5][8]);
+
+/**
+ * @brief Support de persistance du magasin de profils (flash, fichier, mémoire...).
+ *
+ * Accès séquentiel par petits blocs (en-tête puis un profil à la fois) : le
+ * magasin n'a jamais besoin d'un tampon de la taille du fichier. open(true)
+ * remplace le contenu ; read() lit exactement len octets, ESP_ERR_INVALID_SIZE
+ * si le support s'arrête avant.
+ */
+class ProfileBackend {
+public:
+    virtual ~ProfileBackend() = default;
+    virtual esp_err_t open(bool for_write) = 0;
+    virtual esp_err_t read(uint8_t* data, size_t len) = 0;
+    virtual esp_err_t write(const uint8_t* data, size_t len) = 0;
+    virtual esp_err_t close() = 0;
+};
+
+/**
+ * @brief Persistance dans un fichier (VFS ESP-IDF : SPIFFS, FAT... ou fichier sur hôte).
+ */
+class FileProfileBackend : public ProfileBackend {
+public:
+    explicit FileProfileBackend(const char* path) : path(path) {}
+    ~FileProfileBackend() override { close(); }
+
+    esp_err_t open(bool for_write) override;
+    esp_err_t read(uint8_t* data, size_t len) override;
+    esp_err_t write(const uint8_t* data, size_t len) override;
+    esp_err_t close() override;
+
+private:
+    const char* path;
+    FILE* file = nullptr;
+};
+
+/**
+ * @brief Magasin de profils NVM nommés.
+ *
+ * Format binaire (petit-boutiste) : "SPRF", version, nombre de profils, puis
+ * pour chaque profil : longueur du nom, nom (sans zéro final), 40 octets
+ * d'image et CRC-32. Un profil dont le CRC ne correspond pas est rejeté.
+ */
+class ProfileStore {
+public:
+    static constexpr size_t MaxProfiles = 16;
+    static constexpr size_t MaxRecordSize = 1 + NvmProfile::MaxName + 40 + 4;
+    static constexpr size_t MaxEncodedSize = 6 + MaxProfiles * MaxRecordSize;
+
+    // Ajoute ou remplace le profil de même nom
+    esp_err_t add(const char* name, const uint8_t image[5][8]);
+    bool remove(const char* name);
+    const NvmProfile* find(const char* name) const;
+
+    size_t size() const { return profiles.size(); }
+    const NvmProfile& at(size_t index) const { return profiles[index]; }
+
+    // Encodage binaire : renvoie la taille écrite, 0 si out est trop petit
+    size_t encoded_size() const;
+    size_t encode(uint8_t* out, size_t max) const;
+    esp_err_t decode(const uint8_t* data, size_t len);
+
+    // Profil par profil : un seul enregistrement (MaxRecordSize) sur la pile
+    esp_err_t save(ProfileBackend& backend) const;
+    esp_err_t load(ProfileBackend& backend);
+
+private:
+    std::vector<NvmProfile> profiles;
+};
+
+} // namespace stusb4500
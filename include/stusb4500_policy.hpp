@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "stusb4500_units.hpp"
+
+namespace stusb4500 {
+
+/**
+ * @brief Capacités annoncées par la source (dernier message Source_Capabilities reçu).
+ */
+struct SourceCapabilities {
+    static constexpr size_t MaxObjects = 7;
+
+    int64_t timestamp_us = 0;
+    uint8_t count = 0;                  // 0 = aucune capacité reçue depuis l'attache
+    uint32_t pdo[MaxObjects] = {};      // PDO source bruts
+};
+
+/**
+ * @brief Objectif de négociation : plage de tension acceptée et puissance visée.
+ */
+struct PowerPolicy {
+    float min_voltage = 5.0f;   // V
+    float max_voltage = 20.0f;  // V
+    float target_power = 0.0f;  // W, 0 = puissance maximale disponible
+    float max_current = 5.0f;   // A, limite côté sink
+};
+
+/**
+ * @brief Jeu de PDO sink à programmer (PDO1 toujours 5 V).
+ *
+ * Le STUSB4500 demande le PDO sink de rang le plus élevé compatible avec la
+ * source : le choix préféré est donc placé en dernier.
+ */
+struct SinkPdoSet {
+    uint8_t count = 0;          // 1..3, 0 = aucun PDO source compatible
+    uint32_t pdo[3] = {};
+};
+
+// PDO fixe (source ou sink) : type bits [31:30] = 00 ; tension et courant
+// occupent les mêmes champs des deux côtés et se décodent avec SinkPdo
+constexpr bool pdo_is_fixed(uint32_t pdo) { return (pdo >> 30) == 0; }
+
+/**
+ * @brief Vue décodée d'un PDO sink fixe (DPM_SNK_PDO1..3).
+ *
+ * decode() puis encode() restitue le mot d'origine, hors bits réservés [22:20].
+ */
+struct SinkPdo {
+    Millivolts voltage;                 // bits [19:10], pas de 50 mV
+    Milliamps current;                  // courant opérationnel, bits [9:0], pas de 10 mA
+    uint8_t fast_role_swap = 0;         // bits [24:23] : 0 = non supporté, 1 = défaut USB, 2 = 1,5 A, 3 = 3 A
+    bool dual_role_data = false;        // bit 25
+    bool usb_comm_capable = false;      // bit 26
+    bool unconstrained_power = false;   // bit 27
+    bool higher_capability = false;     // bit 28
+    bool dual_role_power = false;       // bit 29
+
+    static constexpr SinkPdo decode(uint32_t raw) {
+        SinkPdo p;
+        p.voltage = codec::pdo_voltage((raw >> 10) & 0x3FF);
+        p.current = codec::pdo_current(raw & 0x3FF);
+        p.fast_role_swap = (raw >> 23) & 0x03;
+        p.dual_role_data = raw & (1u << 25);
+        p.usb_comm_capable = raw & (1u << 26);
+        p.unconstrained_power = raw & (1u << 27);
+        p.higher_capability = raw & (1u << 28);
+        p.dual_role_power = raw & (1u << 29);
+        return p;
+    }
+
+    constexpr uint32_t encode() const {
+        return (static_cast<uint32_t>(codec::pdo_voltage_field(voltage)) << 10)
+            | codec::pdo_current_field(current)
+            | (static_cast<uint32_t>(fast_role_swap & 0x03) << 23)
+            | (dual_role_data ? 1u << 25 : 0)
+            | (usb_comm_capable ? 1u << 26 : 0)
+            | (unconstrained_power ? 1u << 27 : 0)
+            | (higher_capability ? 1u << 28 : 0)
+            | (dual_role_power ? 1u << 29 : 0);
+    }
+};
+
+/**
+ * @brief Calcule le meilleur jeu de PDO sink pour une politique donnée.
+ *
+ * Sans appel I2C ni allocation : peut être évalué à chaque changement de politique.
+ * Avec target_power > 0, la plus basse tension atteignant la puissance est préférée
+ * (courant demandé = puissance / tension) ; sinon la puissance maximale.
+ */
+SinkPdoSet select_sink_pdos(const SourceCapabilities& caps, const PowerPolicy& policy);
+
+} // namespace stusb4500
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include "sdkconfig.h"
+
+namespace stusb4500 {
+
+// API publique à laquelle une transaction I2C est attribuée (nom affiché)
+#define STUSB4500_PROFILE_APIS(X)                          \
+    X(Other, "autre")                                       \
+    X(SyncTask, "sync_task")                                \
+    X(CommandQueue, "command_queue")                        \
+    X(Read, "read")                                         \
+    X(ReadSectors, "read_sectors")                          \
+    X(WriteSectors, "write_sectors")                        \
+    X(WriteSector, "write_sector")                          \
+    X(WriteDefaultSectors, "write_default_sectors")         \
+    X(WriteSectorsDiff, "write_sectors_diff")               \
+    X(ProgramSectors, "program_sectors")                    \
+    X(ApplyNvmProfile, "apply_nvm_profile")                 \
+    X(EnterWriteMode, "enter_write_mode")                   \
+    X(ExitTestMode, "exit_test_mode")                       \
+    X(SoftReset, "soft_reset")                              \
+    X(ReadPdo, "read_pdo")                                  \
+    X(WritePdo, "write_pdo")                                \
+    X(ReadPdos, "read_pdos")                                \
+    X(WritePdos, "write_pdos")                              \
+    X(GetPdoNumber, "get_pdo_number")                       \
+    X(SetVoltage, "set_voltage")                            \
+    X(SetCurrent, "set_current")                            \
+    X(SetPdoNumber, "set_pdo_number")                       \
+    X(SetUpperVoltageLimit, "set_upper_voltage_limit")      \
+    X(SetLowerVoltageLimit, "set_lower_voltage_limit")      \
+    X(SetFlexCurrent, "set_flex_current")                   \
+    X(SetExternalPower, "set_external_power")               \
+    X(SetUsbCommCapable, "set_usb_comm_capable")            \
+    X(SetConfigOkGpio, "set_config_ok_gpio")                \
+    X(SetGpioCtrl, "set_gpio_ctrl")                         \
+    X(SetPowerAbove5vOnly, "set_power_above_5v_only")       \
+    X(SetReqSrcCurrent, "set_req_src_current")              \
+    X(BeginConfig, "begin_config")                          \
+    X(Commit, "commit")                                     \
+    X(ConfigureAlertPin, "configure_alert_pin")             \
+    X(SyncVolatile, "sync_volatile")                        \
+    X(ApplySinkPdos, "apply_sink_pdos")                     \
+    X(ApplyPowerPolicy, "apply_power_policy")
+
+enum class ProfileApi : uint8_t {
+#define STUSB4500_PROFILE_ENUM(id, name) id,
+    STUSB4500_PROFILE_APIS(STUSB4500_PROFILE_ENUM)
+#undef STUSB4500_PROFILE_ENUM
+    Count
+};
+
+const char* profile_api_name(ProfileApi api);
+
+/**
+ * @brief Trafic I2C attribué à une API publique.
+ */
+struct ApiProfile {
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+    uint32_t errors = 0;
+    uint32_t max_us = 0;        // pire transaction
+    uint64_t total_us = 0;
+};
+
+#if CONFIG_STUSB4500_PROFILING
+
+/**
+ * @brief Attribue les transactions de la tâche courante à une API.
+ *
+ * La portée la plus externe l'emporte : set_gpio_ctrl() -> begin_config() ->
+ * read_sectors() est compté sous set_gpio_ctrl.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileApi api, bool override = false) : previous(current) {
+        if (override || current == ProfileApi::Other)
+            current = api;
+    }
+    ~ProfileScope() { current = previous; }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    static ProfileApi active() { return current; }
+
+private:
+    ProfileApi previous;
+    static thread_local ProfileApi current;
+};
+
+#define STUSB_PROFILE_SCOPE(api) ::stusb4500::ProfileScope stusb_profile_scope_(::stusb4500::ProfileApi::api)
+// Remplace l'attribution en cours (ex. file de commandes exécutée depuis la tâche de synchronisation)
+#define STUSB_PROFILE_OVERRIDE(api) ::stusb4500::ProfileScope stusb_profile_scope_(::stusb4500::ProfileApi::api, true)
+
+#else
+
+#define STUSB_PROFILE_SCOPE(api) ((void)0)
+#define STUSB_PROFILE_OVERRIDE(api) ((void)0)
+
+#endif
+
+} // namespace stusb4500
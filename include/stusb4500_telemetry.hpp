@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace stusb4500 {
+
+/**
+ * @brief Contrat négocié observé lors d'une synchronisation.
+ */
+struct ContractRecord {
+    int64_t timestamp_us = 0;
+    uint8_t alert_status = 0;       // ALERT_STATUS_1 ayant déclenché la lecture
+    bool attached = false;          // PORT_STATUS_1.ATTACH
+    uint8_t object_position = 0;    // RDO bits [30:28], 0 = pas de contrat
+    uint16_t operating_ma = 0;      // RDO bits [19:10] (10 mA)
+    uint16_t max_ma = 0;            // RDO bits [9:0] (10 mA)
+    uint8_t pdo_numb = 0;           // DPM_PDO_NUMB
+    uint32_t pdo[3] = {};           // DPM_SNK_PDO1..3 en vigueur
+    uint32_t rdo = 0;               // RDO_REG_STATUS brut
+};
+
+/**
+ * @brief File circulaire sans verrou, un producteur / un consommateur.
+ *
+ * Capacité fixe N (puissance de deux), aucune allocation. Quand la file est
+ * pleine, l'enregistrement est rejeté et compté dans dropped().
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "N doit être une puissance de deux");
+
+public:
+    // Côté producteur
+    bool push(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == N) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Côté consommateur : copie jusqu'à max éléments, renvoie le nombre copié
+    size_t pop(T* out, size_t max) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t avail = head_.load(std::memory_order_acquire) - tail;
+        size_t n = avail < max ? avail : max;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = items_[(tail + i) & (N - 1)];
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    T items_[N] = {};
+    std::atomic<size_t> head_{0};   // écrit par le producteur
+    std::atomic<size_t> tail_{0};   // écrit par le consommateur
+    std::atomic<uint32_t> dropped_{0};
+};
+
+/**
+ * @brief Résumé d'une série de latences (µs).
+ *
+ * min/max/moyenne portent sur toute la série, les centiles sur les derniers
+ * échantillons conservés.
+ */
+struct LatencyStats {
+    uint32_t count = 0;
+    uint32_t min_us = 0;
+    uint32_t avg_us = 0;
+    uint32_t max_us = 0;
+    uint32_t p50_us = 0;
+    uint32_t p90_us = 0;
+    uint32_t p99_us = 0;
+};
+
+/**
+ * @brief Enregistreur de latences à fenêtre fixe de N échantillons, sans allocation.
+ */
+template <size_t N>
+class LatencyRecorder {
+public:
+    void add(uint32_t us) {
+        samples_[count_ % N] = us;
+        count_++;
+        total_us_ += us;
+        if (us < min_us_)
+            min_us_ = us;
+        if (us > max_us_)
+            max_us_ = us;
+    }
+
+    LatencyStats summarize() const {
+        LatencyStats s;
+        s.count = count_;
+        if (count_ == 0)
+            return s;
+        s.min_us = min_us_;
+        s.max_us = max_us_;
+        s.avg_us = static_cast<uint32_t>(total_us_ / count_);
+
+        uint32_t sorted[N];
+        size_t n = count_ < N ? count_ : N;
+        std::copy(samples_, samples_ + n, sorted);
+        std::sort(sorted, sorted + n);
+        s.p50_us = sorted[(n - 1) * 50 / 100];
+        s.p90_us = sorted[(n - 1) * 90 / 100];
+        s.p99_us = sorted[(n - 1) * 99 / 100];
+        return s;
+    }
+
+    void reset() { *this = LatencyRecorder{}; }
+
+private:
+    uint32_t samples_[N] = {};
+    uint32_t count_ = 0;
+    uint64_t total_us_ = 0;
+    uint32_t min_us_ = UINT32_MAX;
+    uint32_t max_us_ = 0;
+};
+
+} // namespace stusb4500
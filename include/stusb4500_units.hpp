@@ -0,0 +1,117 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+
+namespace stusb4500 {
+
+/**
+ * @brief Grandeur entière en milli-unités (mV, mA, mW), sans conversion implicite.
+ *
+ * Tout le driver calcule en entiers ; si() ne sert qu'aux API historiques en float.
+ */
+template <typename Tag>
+struct Quantity {
+    uint32_t value = 0;
+
+    constexpr Quantity() = default;
+    constexpr explicit Quantity(uint32_t v) : value(v) {}
+
+    // Valeur en V, A ou W
+    constexpr float si() const { return value / 1000.0f; }
+    // Arrondi au milli le plus proche, négatif ramené à 0
+    static constexpr Quantity from_si(float v) {
+        return Quantity(v <= 0.0f ? 0 : static_cast<uint32_t>(v * 1000.0f + 0.5f));
+    }
+
+    constexpr Quantity clamp(Quantity lo, Quantity hi) const {
+        return *this < lo ? lo : (hi < *this ? hi : *this);
+    }
+
+    friend constexpr bool operator==(const Quantity&, const Quantity&) = default;
+    friend constexpr auto operator<=>(const Quantity&, const Quantity&) = default;
+    friend constexpr Quantity operator+(Quantity a, Quantity b) { return Quantity(a.value + b.value); }
+    friend constexpr Quantity operator-(Quantity a, Quantity b) { return Quantity(a.value > b.value ? a.value - b.value : 0); }
+};
+
+struct MillivoltTag {};
+struct MilliampTag {};
+struct MilliwattTag {};
+
+using Millivolts = Quantity<MillivoltTag>;
+using Milliamps = Quantity<MilliampTag>;
+using Milliwatts = Quantity<MilliwattTag>;
+
+constexpr Milliwatts operator*(Millivolts v, Milliamps i) {
+    return Milliwatts(static_cast<uint32_t>(static_cast<uint64_t>(v.value) * i.value / 1000));
+}
+
+namespace literals {
+constexpr Millivolts operator""_mV(unsigned long long v) { return Millivolts(static_cast<uint32_t>(v)); }
+constexpr Milliamps operator""_mA(unsigned long long v) { return Milliamps(static_cast<uint32_t>(v)); }
+constexpr Milliwatts operator""_mW(unsigned long long v) { return Milliwatts(static_cast<uint32_t>(v)); }
+} // namespace literals
+
+/**
+ * @brief Codecs exacts entre grandeurs et champs bruts.
+ *
+ * Les valeurs hors pas sont arrondies à la plus proche ; encode(decode(x)) == x
+ * pour toute valeur brute légale (vérifié à la compilation ci-dessous).
+ */
+namespace codec {
+
+// Courant NVM I_SNK_PDOx (4 bits) : 0 = courant flex, puis 0,5..2,75 A par 0,25 A, 3..5 A par 0,5 A
+inline constexpr uint16_t NvmCurrentTable[16] = {
+    0, 500, 750, 1000, 1250, 1500, 1750, 2000, 2250, 2500, 2750, 3000, 3500, 4000, 4500, 5000,
+};
+
+constexpr Milliamps nvm_current(uint8_t code) {
+    return Milliamps(NvmCurrentTable[code & 0x0F]);
+}
+
+constexpr uint8_t nvm_current_code(Milliamps current) {
+    auto distance = [&](uint8_t code) {
+        uint32_t table = NvmCurrentTable[code];
+        return current.value > table ? current.value - table : table - current.value;
+    };
+    uint8_t best = 0;
+    for (uint8_t code = 1; code < 16; ++code)
+        if (distance(code) < distance(best)) // à égalité, le courant le plus faible
+            best = code;
+    return best;
+}
+
+// PDO sink fixe : tension bits [19:10] par pas de 50 mV, courant bits [9:0] par pas de 10 mA
+constexpr uint16_t PdoFieldMax = 0x3FF;
+
+constexpr Millivolts pdo_voltage(uint16_t field) { return Millivolts((field & PdoFieldMax) * 50u); }
+constexpr Milliamps pdo_current(uint16_t field) { return Milliamps((field & PdoFieldMax) * 10u); }
+
+constexpr uint16_t pdo_voltage_field(Millivolts v) {
+    uint32_t field = (v.value + 25) / 50;
+    return static_cast<uint16_t>(field > PdoFieldMax ? PdoFieldMax : field);
+}
+
+constexpr uint16_t pdo_current_field(Milliamps i) {
+    uint32_t field = (i.value + 5) / 10;
+    return static_cast<uint16_t>(field > PdoFieldMax ? PdoFieldMax : field);
+}
+
+namespace detail {
+constexpr bool round_trips() {
+    for (uint8_t code = 0; code < 16; ++code)
+        if (nvm_current_code(nvm_current(code)) != code)
+            return false;
+    for (uint16_t field = 0; field <= PdoFieldMax; ++field)
+        if (pdo_voltage_field(pdo_voltage(field)) != field || pdo_current_field(pdo_current(field)) != field)
+            return false;
+    return true;
+}
+} // namespace detail
+
+static_assert(detail::round_trips(), "codec non réversible");
+
+} // namespace codec
+
+} // namespace stusb4500
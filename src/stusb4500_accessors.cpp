@@ -1,35 +1,47 @@
 #include "stusb4500_internal.hpp"
-#include "stusb4500_register_map.h"
+#include "stusb4500_fields.hpp"
+#include "STUSB4500_register_map.h"
 
 namespace stusb4500
 {
     float STUSB4500::get_voltage(uint8_t pdo_numb)
     {
-        STUSB_CHECK_AVAILABLE_RET(0.0f);
-        if (pdo_numb < 1 || pdo_numb > 3)
-            return 0.0f;
-        return pdos[pdo_numb - 1].voltage;
+        return get_voltage_mv(pdo_numb).si();
     }
 
     float STUSB4500::get_current(uint8_t pdo_numb)
     {
-        STUSB_CHECK_AVAILABLE_RET(0.0f);
+        return get_current_ma(pdo_numb).si();
+    }
+
+    Millivolts STUSB4500::get_voltage_mv(uint8_t pdo_numb)
+    {
+        STUSB_CHECK_AVAILABLE_RET(Millivolts());
+        if (pdo_numb < 1 || pdo_numb > 3)
+            return Millivolts();
+        return get_snapshot().pdos[pdo_numb - 1].voltage;
+    }
+
+    Milliamps STUSB4500::get_current_ma(uint8_t pdo_numb)
+    {
+        STUSB_CHECK_AVAILABLE_RET(Milliamps());
         if (pdo_numb < 1 || pdo_numb > 3)
-            return 0.0f;
-        return pdos[pdo_numb - 1].current;
+            return Milliamps();
+        return get_snapshot().pdos[pdo_numb - 1].current;
     }
 
     uint8_t STUSB4500::get_upper_voltage_limit(uint8_t pdo_numb)
     {
         STUSB_CHECK_AVAILABLE_RET(0);
+        const Snapshot snap = get_snapshot();
         switch (pdo_numb)
         {
         case 1:
-            return ((sector[3][3] >> 4) & 0x0F) + 5;
+            return nvm::get<nvm::Pdo1UpperLimit>(snap.sector);
         case 2:
-            return (sector[3][5] & 0x0F) + 5;
+            return nvm::get<nvm::Pdo2UpperLimit>(snap.sector);
         case 3:
-            return (sector[3][6] >> 4) + 5;
+            return nvm::get<nvm::Pdo3UpperLimit>(snap.sector);
         default:
             return 0;
         }
@@ -38,12 +50,13 @@ namespace stusb4500
     uint8_t STUSB4500::get_lower_voltage_limit(uint8_t pdo_numb)
     {
         STUSB_CHECK_AVAILABLE_RET(0);
+        const Snapshot snap = get_snapshot();
         switch (pdo_numb)
         {
         case 2:
-            return (sector[3][4] >> 4) + 5;
+            return nvm::get<nvm::Pdo2LowerLimit>(snap.sector);
         case 3:
-            return (sector[3][6] & 0x0F) + 5;
+            return nvm::get<nvm::Pdo3LowerLimit>(snap.sector);
         default:
             return 0; // PDO1 non configurable
         }
@@ -51,52 +64,66 @@ namespace stusb4500
 
     float STUSB4500::get_flex_current()
     {
-        STUSB_CHECK_AVAILABLE_RET(0);
-        uint16_t raw = ((sector[4][4] & 0x0F) << 6) | ((sector[4][3] & 0xFC) >> 2);
-        return raw / 100.0f;
+        return get_flex_current_ma().si();
+    }
+
+    Milliamps STUSB4500::get_flex_current_ma()
+    {
+        STUSB_CHECK_AVAILABLE_RET(Milliamps());
+        const Snapshot snap = get_snapshot();
+        return Milliamps(nvm::get<nvm::FlexCurrent>(snap.sector));
     }
 
     uint8_t STUSB4500::get_pdo_number()
     {
+        STUSB_PROFILE_SCOPE(GetPdoNumber);
         STUSB_CHECK_AVAILABLE_RET(0);
         uint8_t value = 0;
-        read(DPM_PDO_NUMB, &value, 1); // Valeur volatile actuelle
+        if (shadow_pdo_numb(value))
+            return value;
+        read(DPM_PDO_NUMB, &value, 1); // Valeur volatile actuelle (mise en cache par read())
         return value & 0x07;
     }
 
     uint8_t STUSB4500::get_external_power()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return (sector[3][2] >> 3) & 0x01;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::ExternalPower>(snap.sector);
     }
 
     uint8_t STUSB4500::get_usb_comm_capable()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return sector[3][2] & 0x01;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::UsbCommCapable>(snap.sector);
     }
 
     uint8_t STUSB4500::get_config_ok_gpio()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return (sector[4][4] >> 5) & 0x03;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::ConfigOkGpio>(snap.sector);
     }
 
     uint8_t STUSB4500::get_gpio_ctrl()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return (sector[1][0] >> 4) & 0x03;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::GpioCtrl>(snap.sector);
     }
 
     uint8_t STUSB4500::get_power_above_5v_only()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return (sector[4][6] >> 3) & 0x01;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::PowerAbove5vOnly>(snap.sector);
     }
 
     uint8_t STUSB4500::get_req_src_current()
     {
         STUSB_CHECK_AVAILABLE_RET(0);
-        return (sector[4][6] >> 4) & 0x01;
+        const Snapshot snap = get_snapshot();
+        return nvm::get<nvm::ReqSrcCurrent>(snap.sector);
     }
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "stusb4500_internal.hpp"
+#include <esp_check.h>
+
+namespace
+{
+    using namespace stusb4500;
+
+    void add_to_transaction(ConfigTransaction &tx, const Command &cmd)
+    {
+        uint8_t value = static_cast<uint8_t>(cmd.value);
+        switch (cmd.kind)
+        {
+        case Command::Kind::UpperVoltageLimit:
+            tx.set_upper_voltage_limit(cmd.pdo_numb, value);
+            break;
+        case Command::Kind::LowerVoltageLimit:
+            tx.set_lower_voltage_limit(cmd.pdo_numb, value);
+            break;
+        case Command::Kind::FlexCurrent:
+            tx.set_flex_current(Milliamps(cmd.value));
+            break;
+        case Command::Kind::ExternalPower:
+            tx.set_external_power(value);
+            break;
+        case Command::Kind::UsbCommCapable:
+            tx.set_usb_comm_capable(value);
+            break;
+        case Command::Kind::ConfigOkGpio:
+            tx.set_config_ok_gpio(value);
+            break;
+        case Command::Kind::GpioCtrl:
+            tx.set_gpio_ctrl(value);
+            break;
+        case Command::Kind::PowerAbove5vOnly:
+            tx.set_power_above_5v_only(value);
+            break;
+        case Command::Kind::ReqSrcCurrent:
+            tx.set_req_src_current(value);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+namespace stusb4500
+{
+    std::expected<CommandTicket, esp_err_t> STUSB4500::submit(const Command &cmd, CommandCallback done)
+    {
+        TaskHandle_t task = notify_task;
+        if (!task && !polled.load(std::memory_order_acquire))
+            return std::unexpected(ESP_ERR_INVALID_STATE); // ni tâche ni run_once() pour exécuter la file
+
+        xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+        CommandTicket ticket{next_command_id++};
+        command_stats.submitted++;
+
+        // Fusion avec la dernière commande de même cible, si aucune barrière ne suit
+        // (une barrière ne fusionne qu'avec la queue de file)
+        bool merged = false;
+        for (size_t i = command_count; i > command_busy; --i)
+        {
+            QueuedCommand &q = command_queue[(command_head + i - 1) % CommandQueueDepth];
+            if (q.cmd.same_target(cmd) && q.waiters < CommandMaxMerged)
+            {
+                q.cmd = cmd;
+                q.ids[q.waiters] = ticket.id;
+                q.callbacks[q.waiters] = std::move(done);
+                q.waiters++;
+                merged = true;
+                break;
+            }
+            if (q.cmd.is_barrier() || cmd.is_barrier())
+                break;
+        }
+
+        if (merged)
+        {
+            command_stats.merged++;
+        }
+        else if (command_count == CommandQueueDepth)
+        {
+            command_stats.rejected++;
+            xSemaphoreGiveRecursive(command_mutex);
+            return std::unexpected(ESP_ERR_NO_MEM);
+        }
+        else
+        {
+            QueuedCommand &q = command_queue[(command_head + command_count) % CommandQueueDepth];
+            q.cmd = cmd;
+            q.ids[0] = ticket.id;
+            q.callbacks[0] = std::move(done);
+            q.waiters = 1;
+            command_count++;
+        }
+        xSemaphoreGiveRecursive(command_mutex);
+
+        if (task)
+            xTaskNotify(task, command_bits, eSetBits); // sinon : prochain run_once()
+        return ticket;
+    }
+
+    void STUSB4500::run_commands()
+    {
+        STUSB_PROFILE_OVERRIDE(CommandQueue);
+        while (true)
+        {
+            // Tête de file : une commande, ou toutes les commandes NVM consécutives
+            Command batch[CommandQueueDepth];
+            size_t n = 0;
+
+            xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+            while (n < command_count)
+            {
+                const Command &cmd = command_queue[(command_head + n) % CommandQueueDepth].cmd;
+                if (n > 0 && !(cmd.is_nvm() && batch[0].is_nvm()))
+                    break;
+                batch[n++] = cmd;
+                if (!cmd.is_nvm())
+                    break;
+            }
+            command_busy = n;
+            xSemaphoreGiveRecursive(command_mutex);
+
+            if (n == 0)
+                return;
+
+            esp_err_t err;
+            if (batch[0].is_nvm())
+            {
+                ConfigTransaction tx = begin_config();
+                for (size_t i = 0; i < n; ++i)
+                    add_to_transaction(tx, batch[i]);
+                err = tx.commit();
+            }
+            else
+            {
+                err = execute_command(batch[0]);
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+                QueuedCommand done = std::move(command_queue[command_head]);
+                command_queue[command_head] = QueuedCommand{};
+                command_head = (command_head + 1) % CommandQueueDepth;
+                command_count--;
+                command_busy--;
+
+                for (uint8_t w = 0; w < done.waiters; ++w)
+                {
+                    command_results[command_result_next] = CompletedCommand{done.ids[w], err};
+                    command_result_next = (command_result_next + 1) % CommandResults;
+                }
+                if (i == 0)
+                {
+                    command_stats.executed++;
+                    if (batch[0].is_nvm())
+                        command_stats.nvm_commits++;
+                    if (err != ESP_OK)
+                        command_stats.failed++;
+                }
+                xSemaphoreGiveRecursive(command_mutex);
+
+                // Rappels hors verrou : ils peuvent soumettre d'autres commandes
+                CommandResult result = err == ESP_OK ? CommandResult{} : std::unexpected(err);
+                for (uint8_t w = 0; w < done.waiters; ++w)
+                    if (done.callbacks[w])
+                        done.callbacks[w](result);
+            }
+
+            xEventGroupSetBits(snapshot_events, CommandDoneBit);
+            xEventGroupClearBits(snapshot_events, CommandDoneBit);
+        }
+    }
+
+    esp_err_t STUSB4500::execute_command(const Command &cmd)
+    {
+        if (!available)
+            return ESP_ERR_INVALID_STATE;
+
+        switch (cmd.kind)
+        {
+        case Command::Kind::SetVoltage:
+            return apply_voltage(cmd.pdo_numb, Millivolts(cmd.value));
+        case Command::Kind::SetCurrent:
+            return apply_current(cmd.pdo_numb, Milliamps(cmd.value));
+        case Command::Kind::SetPdoNumber:
+            return apply_pdo_number(static_cast<uint8_t>(cmd.value));
+        case Command::Kind::SoftReset:
+            return soft_reset();
+        case Command::Kind::ApplySinkPdos:
+            return apply_sink_pdos(cmd.pdos);
+        case Command::Kind::ApplyPowerPolicy:
+            return apply_power_policy(cmd.policy);
+        default:
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    bool STUSB4500::command_pending(uint32_t id) const
+    {
+        for (size_t i = 0; i < command_count; ++i)
+        {
+            const QueuedCommand &q = command_queue[(command_head + i) % CommandQueueDepth];
+            for (uint8_t w = 0; w < q.waiters; ++w)
+                if (q.ids[w] == id)
+                    return true;
+        }
+        return false;
+    }
+
+    CommandResult STUSB4500::wait(CommandTicket ticket, TickType_t timeout)
+    {
+        TickType_t start = xTaskGetTickCount();
+
+        while (true)
+        {
+            xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+            for (const CompletedCommand &c : command_results)
+            {
+                if (c.id == ticket.id && c.id != 0)
+                {
+                    esp_err_t err = c.err;
+                    xSemaphoreGiveRecursive(command_mutex);
+                    if (err != ESP_OK)
+                        return std::unexpected(err);
+                    return {};
+                }
+            }
+
+            // Ni en file ni dans l'historique : résultat écrasé par CommandResults
+            // commandes plus récentes (ou ticket invalide), l'attente ne finirait jamais
+            bool pending = command_pending(ticket.id);
+            xSemaphoreGiveRecursive(command_mutex);
+            if (!pending)
+                return std::unexpected(ESP_ERR_NOT_FOUND);
+
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && elapsed >= timeout)
+                return std::unexpected(ESP_ERR_TIMEOUT);
+
+            // Même attente par tranches que wait_for_generation()
+            TickType_t slice = SnapshotWaitSlice;
+            if (timeout != portMAX_DELAY && timeout - elapsed < slice)
+                slice = timeout - elapsed;
+            xEventGroupWaitBits(snapshot_events, CommandDoneBit, pdFALSE, pdFALSE, slice);
+        }
+    }
+
+    CommandStats STUSB4500::get_command_stats() const
+    {
+        xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+        CommandStats stats = command_stats;
+        xSemaphoreGiveRecursive(command_mutex);
+        return stats;
+    }
+}
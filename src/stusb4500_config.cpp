@@ -1,190 +1,152 @@
 #include "stusb4500_internal.hpp"
-#include "stusb4500_register_map.h"
+#include "STUSB4500_register_map.h"
 
 namespace stusb4500
 {
     void STUSB4500::set_voltage(uint8_t pdo_numb, float voltage)
     {
+        set_voltage(pdo_numb, Millivolts::from_si(voltage));
+    }
+
+    void STUSB4500::set_current(uint8_t pdo_numb, float current)
+    {
+        set_current(pdo_numb, Milliamps::from_si(current));
+    }
+
+    void STUSB4500::set_voltage(uint8_t pdo_numb, Millivolts voltage)
+    {
+        STUSB_PROFILE_SCOPE(SetVoltage);
+        STUSB_CHECK_AVAILABLE();
+        apply_voltage(pdo_numb, voltage);
+    }
+
+    void STUSB4500::set_current(uint8_t pdo_numb, Milliamps current)
+    {
+        STUSB_PROFILE_SCOPE(SetCurrent);
+        STUSB_CHECK_AVAILABLE();
+        apply_current(pdo_numb, current);
+    }
+
+    void STUSB4500::set_pdo_number(uint8_t value)
+    {
+        STUSB_PROFILE_SCOPE(SetPdoNumber);
         STUSB_CHECK_AVAILABLE();
+        apply_pdo_number(value);
+    }
+
+    esp_err_t STUSB4500::apply_voltage(uint8_t pdo_numb, Millivolts voltage)
+    {
         if (pdo_numb < 1 || pdo_numb > 3)
-            return;
+            return ESP_ERR_INVALID_ARG;
         if (pdo_numb == 1)
-            voltage = 5.0f;
+            voltage = Millivolts(5000);
 
-        if (voltage < 5.0f)
-            voltage = 5.0f;
-        if (voltage > 20.0f)
-            voltage = 20.0f;
+        voltage = voltage.clamp(Millivolts(5000), Millivolts(20000));
 
+        SequenceGuard guard(*this); // lecture-modification-écriture du PDO
         uint32_t pdo;
-        if (read_pdo(pdo_numb, pdo) != ESP_OK)
-            return;
+        esp_err_t err = read_pdo(pdo_numb, pdo);
+        if (err != ESP_OK)
+            return err;
 
         pdo &= ~(0x3FF << 10);
-        pdo |= (static_cast<uint32_t>(voltage * 20) & 0x3FF) << 10;
+        pdo |= static_cast<uint32_t>(codec::pdo_voltage_field(voltage)) << 10;
 
-        write_pdo(pdo_numb, pdo);
+        return write_pdo(pdo_numb, pdo);
     }
 
-    void STUSB4500::set_current(uint8_t pdo_numb, float current)
+    esp_err_t STUSB4500::apply_current(uint8_t pdo_numb, Milliamps current)
     {
-        STUSB_CHECK_AVAILABLE();
         if (pdo_numb < 1 || pdo_numb > 3)
-            return;
+            return ESP_ERR_INVALID_ARG;
 
-        if (current < 0.0f)
-            current = 0.0f;
-        if (current > 5.0f)
-            current = 5.0f;
+        current = current.clamp(Milliamps(0), Milliamps(5000));
 
+        SequenceGuard guard(*this); // lecture-modification-écriture du PDO
         uint32_t pdo;
-        if (read_pdo(pdo_numb, pdo) != ESP_OK)
-            return;
+        esp_err_t err = read_pdo(pdo_numb, pdo);
+        if (err != ESP_OK)
+            return err;
 
         pdo &= ~0x3FF;
-        pdo |= static_cast<uint32_t>(current / 0.01f) & 0x3FF;
+        pdo |= codec::pdo_current_field(current);
 
-        write_pdo(pdo_numb, pdo);
+        return write_pdo(pdo_numb, pdo);
     }
 
-    void STUSB4500::set_pdo_number(uint8_t value)
+    esp_err_t STUSB4500::apply_pdo_number(uint8_t value)
     {
-        STUSB_CHECK_AVAILABLE();
         if (value > 3)
             value = 3;
         uint8_t buf = value;
-        write(DPM_PDO_NUMB, &buf, 1);
+        return write(DPM_PDO_NUMB, &buf, 1);
     }
 
     void STUSB4500::set_upper_voltage_limit(uint8_t pdo_numb, uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetUpperVoltageLimit);
         STUSB_CHECK_AVAILABLE();
-        if (value < 5)
-            value = 5;
-        if (value > 20)
-            value = 20;
-
-        read_sectors();
-
-        switch (pdo_numb)
-        {
-        case 1:
-            sector[3][3] = (sector[3][3] & 0x0F) | ((value - 5) << 4);
-            write_sector(3, sector[3]);
-            break;
-        case 2:
-            sector[3][5] = (sector[3][5] & 0xF0) | (value - 5);
-            write_sector(3, sector[3]);
-            break;
-        case 3:
-            sector[3][6] = (sector[3][6] & 0x0F) | ((value - 5) << 4);
-            write_sector(3, sector[3]);
-            break;
-        }
+        begin_config().set_upper_voltage_limit(pdo_numb, value).commit();
     }
 
     void STUSB4500::set_lower_voltage_limit(uint8_t pdo_numb, uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetLowerVoltageLimit);
         STUSB_CHECK_AVAILABLE();
-        if (value < 5)
-            value = 5;
-        if (value > 20)
-            value = 20;
-
-        read_sectors();
-
-        switch (pdo_numb)
-        {
-        case 2:
-            sector[3][4] = (sector[3][4] & 0x0F) | ((value - 5) << 4);
-            write_sector(3, sector[3]);
-            break;
-        case 3:
-            sector[3][6] = (sector[3][6] & 0xF0) | (value - 5);
-            write_sector(3, sector[3]);
-            break;
-        }
+        begin_config().set_lower_voltage_limit(pdo_numb, value).commit();
     }
 
     void STUSB4500::set_flex_current(float value)
     {
-        STUSB_CHECK_AVAILABLE();
-        if (value < 0.0f)
-            value = 0.0f;
-        if (value > 5.0f)
-            value = 5.0f;
-
-        read_sectors();
-
-        uint16_t raw = static_cast<uint16_t>(value * 100);
-
-        sector[4][3] = (sector[4][3] & 0x03) | ((raw & 0x3F) << 2);
-        sector[4][4] = (sector[4][4] & 0xF0) | ((raw >> 6) & 0x0F);
+        set_flex_current(Milliamps::from_si(value));
+    }
 
-        write_sector(4, sector[4]);
+    void STUSB4500::set_flex_current(Milliamps value)
+    {
+        STUSB_PROFILE_SCOPE(SetFlexCurrent);
+        STUSB_CHECK_AVAILABLE();
+        begin_config().set_flex_current(value).commit();
     }
 
     void STUSB4500::set_external_power(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetExternalPower);
         STUSB_CHECK_AVAILABLE();
-        value = value ? 1 : 0;
-
-        read_sectors();
-        sector[3][2] = (sector[3][2] & 0xF7) | (value << 3);
-        write_sector(3, sector[3]);
+        begin_config().set_external_power(value).commit();
     }
 
     void STUSB4500::set_usb_comm_capable(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetUsbCommCapable);
         STUSB_CHECK_AVAILABLE();
-        value = value ? 1 : 0;
-
-        read_sectors();
-        sector[3][2] = (sector[3][2] & 0xFE) | value;
-        write_sector(3, sector[3]);
+        begin_config().set_usb_comm_capable(value).commit();
     }
 
     void STUSB4500::set_config_ok_gpio(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetConfigOkGpio);
         STUSB_CHECK_AVAILABLE();
-        if (value < 2)
-            value = 0;
-        else if (value > 3)
-            value = 3;
-
-        read_sectors();
-        sector[4][4] = (sector[4][4] & 0x9F) | (value << 5);
-        write_sector(4, sector[4]);
+        begin_config().set_config_ok_gpio(value).commit();
     }
 
     void STUSB4500::set_gpio_ctrl(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetGpioCtrl);
         STUSB_CHECK_AVAILABLE();
-        if (value > 3)
-            value = 3;
-
-        read_sectors();
-        sector[1][0] = (sector[1][0] & 0xCF) | (value << 4);
-        write_sector(1, sector[1]);
+        begin_config().set_gpio_ctrl(value).commit();
     }
 
     void STUSB4500::set_power_above_5v_only(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetPowerAbove5vOnly);
         STUSB_CHECK_AVAILABLE();
-        value = value ? 1 : 0;
-
-        read_sectors();
-        sector[4][6] = (sector[4][6] & 0xF7) | (value << 3);
-        write_sector(4, sector[4]);
+        begin_config().set_power_above_5v_only(value).commit();
     }
 
     void STUSB4500::set_req_src_current(uint8_t value)
     {
+        STUSB_PROFILE_SCOPE(SetReqSrcCurrent);
         STUSB_CHECK_AVAILABLE();
-        value = value ? 1 : 0;
-
-        read_sectors();
-        sector[4][6] = (sector[4][6] & 0xEF) | (value << 4);
-        write_sector(4, sector[4]);
+        begin_config().set_req_src_current(value).commit();
     }
 }
\ No newline at end of file
@@ -1,32 +1,165 @@
 #include "stusb4500_internal.hpp"
 #include <esp_log.h>
 #include <esp_check.h>
+#include <esp_timer.h>
+#include <cstdio>
 
 namespace stusb4500
 {
-    STUSB4500::STUSB4500(std::shared_ptr<I2CDevice> i2c)
-        : i2c_dev(std::move(i2c)), sector{}
+    STUSB4500::STUSB4500(std::shared_ptr<I2CDevice> i2c, bool start_task)
+        : i2c_dev(std::move(i2c)), bus{i2c_dev.get()}, sector{}
     {
         last_sync_ms = esp_log_timestamp();
-        start_sync_task();
+        created_us = esp_timer_get_time();
+        snapshot_events = xEventGroupCreate();
+        command_mutex = xSemaphoreCreateRecursiveMutex();
+        sequence_mutex = xSemaphoreCreateRecursiveMutex();
+        event_mutex = xSemaphoreCreateRecursiveMutex();
+        state_mutex = xSemaphoreCreateRecursiveMutex();
+        publish_snapshot();
+        if (start_task)
+            start_sync_task();
     }
 
     STUSB4500::~STUSB4500()
     {
+        if (alert_enabled)
+            gpio_isr_handler_remove(alert_gpio);
+
         if (sync_task_handle)
         {
             vTaskDelete(sync_task_handle);
             sync_task_handle = nullptr;
         }
+
+        if (snapshot_events)
+            vEventGroupDelete(snapshot_events);
+        if (command_mutex)
+            vSemaphoreDelete(command_mutex);
+        if (sequence_mutex)
+            vSemaphoreDelete(sequence_mutex);
+        if (event_mutex)
+            vSemaphoreDelete(event_mutex);
+        if (state_mutex)
+            vSemaphoreDelete(state_mutex);
     }
 
     esp_err_t STUSB4500::read(uint8_t reg, uint8_t *data, size_t len)
     {
-        return i2c_dev->read(reg, data, len);
+#if CONFIG_STUSB4500_PROFILING
+        int64_t start = esp_timer_get_time();
+#endif
+        uint32_t epoch = shadow_epoch(); // une écriture concurrente rend la lecture périmée
+        esp_err_t err = bus.read(reg, data, len);
+        bus_transactions.fetch_add(1, std::memory_order_relaxed);
+        bus_bytes.fetch_add(len, std::memory_order_relaxed);
+        if (err != ESP_OK)
+            bus_errors.fetch_add(1, std::memory_order_relaxed);
+        else
+            shadow_store(reg, data, len, &epoch);
+#if CONFIG_STUSB4500_PROFILING
+        profile_transaction(len, err, static_cast<uint32_t>(esp_timer_get_time() - start));
+#endif
+        return err;
+    }
+
+    void STUSB4500::acquire_sequence()
+    {
+        TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+        if (xSemaphoreTakeRecursive(sequence_mutex, 0) != pdTRUE)
+        {
+            // Détenue par une autre tâche : on note qui, puis on attend
+            taskENTER_CRITICAL(&guard_lock);
+            TaskHandle_t holder = sequence_holder;
+            taskEXIT_CRITICAL(&guard_lock);
+
+            int64_t start = esp_timer_get_time();
+            xSemaphoreTakeRecursive(sequence_mutex, portMAX_DELAY);
+            uint32_t waited = static_cast<uint32_t>(esp_timer_get_time() - start);
+
+            taskENTER_CRITICAL(&guard_lock);
+            guard_stats.contended++;
+            guard_stats.total_wait_us += waited;
+            if (waited > guard_stats.max_wait_us)
+                guard_stats.max_wait_us = waited;
+            if (holder)
+                snprintf(guard_stats.last_blocker, sizeof(guard_stats.last_blocker), "%s", pcTaskGetName(holder));
+            taskEXIT_CRITICAL(&guard_lock);
+        }
+
+        if (sequence_depth++ == 0)
+        {
+            taskENTER_CRITICAL(&guard_lock);
+            sequence_holder = self;
+            sequence_since_us = esp_timer_get_time();
+            guard_stats.acquisitions++;
+            taskEXIT_CRITICAL(&guard_lock);
+        }
+    }
+
+    void STUSB4500::release_sequence()
+    {
+        if (--sequence_depth == 0)
+        {
+            uint32_t held = static_cast<uint32_t>(esp_timer_get_time() - sequence_since_us);
+            taskENTER_CRITICAL(&guard_lock);
+            sequence_holder = nullptr;
+            if (held > guard_stats.max_hold_us)
+                guard_stats.max_hold_us = held;
+            taskEXIT_CRITICAL(&guard_lock);
+        }
+        xSemaphoreGiveRecursive(sequence_mutex);
+    }
+
+    GuardStats STUSB4500::get_guard_stats() const
+    {
+        taskENTER_CRITICAL(&guard_lock);
+        GuardStats stats = guard_stats;
+        TaskHandle_t holder = sequence_holder;
+        taskEXIT_CRITICAL(&guard_lock);
+
+        if (holder)
+            snprintf(stats.holder, sizeof(stats.holder), "%s", pcTaskGetName(holder));
+        return stats;
+    }
+
+    void STUSB4500::reset_guard_stats()
+    {
+        taskENTER_CRITICAL(&guard_lock);
+        guard_stats = GuardStats{};
+        taskEXIT_CRITICAL(&guard_lock);
     }
 
     esp_err_t STUSB4500::write(uint8_t reg, const uint8_t *data, size_t len)
     {
-        return i2c_dev->write(reg, data, len);
+#if CONFIG_STUSB4500_PROFILING
+        int64_t start = esp_timer_get_time();
+#endif
+        esp_err_t err = bus.write(reg, data, len);
+        bus_transactions.fetch_add(1, std::memory_order_relaxed);
+        bus_bytes.fetch_add(len, std::memory_order_relaxed);
+        if (err != ESP_OK)
+        {
+            bus_errors.fetch_add(1, std::memory_order_relaxed);
+            invalidate_shadow(); // contenu des registres inconnu
+        }
+        else
+        {
+            shadow_store(reg, data, len, nullptr);
+        }
+#if CONFIG_STUSB4500_PROFILING
+        profile_transaction(len, err, static_cast<uint32_t>(esp_timer_get_time() - start));
+#endif
+        return err;
+    }
+
+    BusStats STUSB4500::get_bus_stats() const
+    {
+        BusStats stats;
+        stats.transactions = bus_transactions.load(std::memory_order_relaxed);
+        stats.bytes = bus_bytes.load(std::memory_order_relaxed);
+        stats.errors = bus_errors.load(std::memory_order_relaxed);
+        return stats;
     }
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "stusb4500_internal.hpp"
+
+namespace stusb4500
+{
+    Subscription STUSB4500::subscribe(EventCallback callback, uint32_t mask)
+    {
+        if (!callback)
+            return Subscription{};
+        Subscriber sub;
+        sub.mask = mask;
+        sub.callback = std::move(callback);
+        return add_subscriber(std::move(sub));
+    }
+
+    Subscription STUSB4500::subscribe(QueueHandle_t queue, uint32_t mask)
+    {
+        if (!queue)
+            return Subscription{};
+        Subscriber sub;
+        sub.mask = mask;
+        sub.queue = queue;
+        return add_subscriber(std::move(sub));
+    }
+
+    Subscription STUSB4500::add_subscriber(Subscriber sub)
+    {
+        xSemaphoreTakeRecursive(event_mutex, portMAX_DELAY);
+        Subscription result;
+        for (Subscriber &slot : subscribers)
+        {
+            if (slot.id != 0)
+                continue;
+            sub.id = next_subscription_id++;
+            if (next_subscription_id == 0)
+                next_subscription_id = 1;
+            slot = std::move(sub);
+            result.id = slot.id;
+            break;
+        }
+        xSemaphoreGiveRecursive(event_mutex);
+
+        if (!result)
+            ESP_LOGW("STUSB4500", "Abonnement refusé : %u abonnés au maximum", (unsigned)MaxSubscribers);
+        return result;
+    }
+
+    void STUSB4500::unsubscribe(Subscription subscription)
+    {
+        if (!subscription)
+            return;
+
+        // Possible depuis un rappel (mutex récursif) : le rappel en cours d'exécution
+        // ne doit pas être détruit, l'emplacement est seulement désactivé et réservé
+        xSemaphoreTakeRecursive(event_mutex, portMAX_DELAY);
+        for (Subscriber &slot : subscribers)
+        {
+            if (slot.id != subscription.id || slot.released)
+                continue;
+            if (publish_depth > 0)
+            {
+                slot.mask = 0;
+                slot.released = true;
+            }
+            else
+            {
+                slot = Subscriber{};
+            }
+        }
+        xSemaphoreGiveRecursive(event_mutex);
+    }
+
+    void STUSB4500::publish_event(Event &event)
+    {
+        const uint32_t bit = event_bit(event.type);
+
+        xSemaphoreTakeRecursive(event_mutex, portMAX_DELAY);
+        event_stats.published++;
+        publish_depth++;
+        for (Subscriber &sub : subscribers)
+        {
+            if (sub.id == 0 || !(sub.mask & bit))
+                continue;
+
+            if (sub.callback)
+            {
+                sub.callback(event);
+                event_stats.delivered++;
+            }
+            else if (xQueueSend(sub.queue, &event, 0) == pdTRUE)
+            {
+                event_stats.delivered++;
+            }
+            else
+            {
+                event_stats.dropped++; // la synchronisation ne patiente jamais sur un abonné
+            }
+        }
+
+        // Plus aucun rappel en cours : les désabonnements différés sont libérés
+        if (--publish_depth == 0)
+            for (Subscriber &sub : subscribers)
+                if (sub.released)
+                    sub = Subscriber{};
+        xSemaphoreGiveRecursive(event_mutex);
+    }
+
+    EventStats STUSB4500::get_event_stats() const
+    {
+        xSemaphoreTakeRecursive(event_mutex, portMAX_DELAY);
+        EventStats stats = event_stats;
+        xSemaphoreGiveRecursive(event_mutex);
+        return stats;
+    }
+}
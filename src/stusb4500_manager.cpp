@@ -0,0 +1,119 @@
+#include "stusb4500_manager.hpp"
+#include "stusb4500_internal.hpp"
+#include <esp_check.h>
+#include <esp_timer.h>
+
+namespace stusb4500
+{
+    DeviceManager::DeviceManager(const ManagerConfig &config)
+        : config(config)
+    {
+    }
+
+    DeviceManager::~DeviceManager()
+    {
+        if (task_handle)
+        {
+            vTaskDelete(task_handle);
+            task_handle = nullptr;
+        }
+        for (auto &entry : entries)
+            entry.dev->set_notifier(nullptr, 0, 0);
+    }
+
+    esp_err_t DeviceManager::add(STUSB4500 &dev)
+    {
+        ESP_RETURN_ON_FALSE(!task_handle, ESP_ERR_INVALID_STATE, "STUSB4500", "Gestionnaire déjà démarré");
+        ESP_RETURN_ON_FALSE(entries.size() < MaxDevices, ESP_ERR_NO_MEM, "STUSB4500", "Trop de périphériques");
+        ESP_RETURN_ON_FALSE(!dev.sync_task_handle, ESP_ERR_INVALID_ARG, "STUSB4500", "Instance avec tâche propre");
+
+        entries.push_back(Entry{&dev, 0, {}});
+        return ESP_OK;
+    }
+
+    esp_err_t DeviceManager::start()
+    {
+        ESP_RETURN_ON_FALSE(!task_handle, ESP_ERR_INVALID_STATE, "STUSB4500", "Gestionnaire déjà démarré");
+
+        BaseType_t ok = xTaskCreatePinnedToCore(
+            &DeviceManager::task,
+            config.task_name,
+            config.stack_size,
+            this,
+            config.priority,
+            &task_handle,
+            config.core);
+        ESP_RETURN_ON_FALSE(ok == pdPASS, ESP_ERR_NO_MEM, "STUSB4500", "Création de tâche impossible");
+
+        // Chaque instance réveille la tâche du gestionnaire avec ses propres bits
+        for (size_t i = 0; i < entries.size(); ++i)
+            entries[i].dev->set_notifier(task_handle, 1u << i, 1u << (i + MaxDevices));
+        return ESP_OK;
+    }
+
+    ServiceStats DeviceManager::get_service_stats(size_t index) const
+    {
+        return index < entries.size() ? entries[index].stats : ServiceStats{};
+    }
+
+    void DeviceManager::reset_service_stats()
+    {
+        for (auto &entry : entries)
+            entry.stats = ServiceStats{};
+    }
+
+    void DeviceManager::task(void *arg)
+    {
+        static_cast<DeviceManager *>(arg)->run();
+    }
+
+    void DeviceManager::run()
+    {
+        uint32_t events = 0;
+
+        while (true)
+        {
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                Entry &entry = entries[i];
+                // Relu à chaque instance : un service lent (commit NVM) décale les suivantes
+                TickType_t now = xTaskGetTickCount();
+                bool alert = events & (1u << i);
+                bool command = events & (1u << (i + MaxDevices));
+
+                if (alert || command || static_cast<int32_t>(entry.due - now) <= 0)
+                {
+                    int64_t start = esp_timer_get_time();
+                    TickType_t next = entry.dev->service((alert ? STUSB4500::NotifyAlert : 0) |
+                                                         (command ? STUSB4500::NotifyCommand : 0));
+                    uint32_t elapsed = static_cast<uint32_t>(esp_timer_get_time() - start);
+
+                    entry.due = xTaskGetTickCount() + next;
+                    entry.stats.services++;
+                    entry.stats.last_us = elapsed;
+                    entry.stats.total_us += elapsed;
+                    if (elapsed > entry.stats.max_us)
+                        entry.stats.max_us = elapsed;
+                    if (alert)
+                        entry.stats.alerts++;
+                }
+            }
+
+            // Attente calculée après tous les services : échéance dépassée entre-temps = 0
+            TickType_t now = xTaskGetTickCount();
+            TickType_t wait = portMAX_DELAY;
+            for (const Entry &entry : entries)
+            {
+                int32_t remaining = static_cast<int32_t>(entry.due - now);
+                if (remaining <= 0)
+                    wait = 0;
+                else if (static_cast<TickType_t>(remaining) < wait)
+                    wait = remaining;
+            }
+
+            // Bloqué jusqu'à une alerte d'une instance ou la prochaine échéance
+            if (xTaskNotifyWait(0, UINT32_MAX, &events, wait) != pdTRUE)
+                events = 0;
+        }
+    }
+}
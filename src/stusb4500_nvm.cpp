@@ -1,90 +1,64 @@
 #include "stusb4500_internal.hpp"
+#include "stusb4500_fields.hpp"
+#include <algorithm>
 #include <cstring> // pour memset
 #include <esp_check.h>
-
-namespace
-{
-    float decode_current(uint8_t val)
-    {
-        if (val == 0)
-            return 0.0f;
-        return val < 11 ? val * 0.25f + 0.25f : val * 0.5f - 2.5f;
-    }
-
-    uint8_t encode_current(float current)
-    {
-        if (current <= 0.25f)
-            return 0;
-        if (current <= 3.0f)
-            return static_cast<uint8_t>((current - 0.25f) / 0.25f);
-        return static_cast<uint8_t>((current + 2.5f) / 0.5f);
-    }
-
-    float decode_voltage(uint16_t val_mV)
-    {
-        return val_mV / 20.0f; // 20mV/LSB
-    }
-
-    uint16_t encode_voltage(float voltage)
-    {
-        return static_cast<uint16_t>(voltage * 20.0f);
-    }
-}
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
 
 namespace stusb4500
 {
     esp_err_t STUSB4500::read()
     {
-        esp_err_t err = read_sectors();
+        STUSB_PROFILE_SCOPE(Read);
+        esp_err_t err = read_sectors(); // sector[] et pdos[] publiés ensemble
         if (err != ESP_OK)
         {
             ESP_LOGE("STUSB4500", "Read failed: %s", esp_err_to_name(err));
             return err;
         }
-
-        uint8_t current;
-
-        pdos[0] = PDO{5.0f, decode_current((sector[3][2] & 0xF0) >> 4)};
-        pdos[1] = PDO{
-            decode_voltage((sector[4][1] << 2) | (sector[4][0] >> 6)),
-            decode_current(sector[3][4] & 0x0F)};
-        pdos[2] = PDO{
-            decode_voltage(((sector[4][3] & 0x03) << 8) | sector[4][2]),
-            decode_current((sector[3][5] & 0xF0) >> 4)};
-
         return ESP_OK;
     }
 
-    esp_err_t STUSB4500::read_sectors()
+    void STUSB4500::decode_pdos(const uint8_t image[5][8], PDO out[3])
     {
-        uint8_t buffer[1];
-
-        buffer[0] = FTP_CUST_PASSWORD;
-        ESP_RETURN_ON_ERROR(write(FTP_CUST_PASSWORD_REG, buffer, 1), "STUSB4500", "Write failed");
-
-        buffer[0] = 0x00;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Write failed");
+        out[0] = PDO{Millivolts(5000), codec::nvm_current(nvm::get<nvm::Pdo1Current>(image))};
+        out[1] = PDO{
+            Millivolts(nvm::get<nvm::Pdo2Voltage>(image)),
+            codec::nvm_current(nvm::get<nvm::Pdo2Current>(image))};
+        out[2] = PDO{
+            Millivolts(nvm::get<nvm::Pdo3Voltage>(image)),
+            codec::nvm_current(nvm::get<nvm::Pdo3Current>(image))};
+    }
 
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Write failed");
+    esp_err_t STUSB4500::read_sectors()
+    {
+        STUSB_PROFILE_SCOPE(ReadSectors);
+        SequenceGuard guard(*this);
 
-        for (uint8_t i = 0; i < SectorCount; ++i)
+        // Lecture dans un tampon local : un échec laisse sector[] intact
+        uint8_t image[SectorCount][SectorSize];
+        esp_err_t err = ftp_unlock();
+        for (uint8_t i = 0; err == ESP_OK && i < SectorCount; ++i)
         {
-            buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N;
-            ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Write failed");
-
-            buffer[0] = (READ & FTP_CUST_OPCODE);
-            ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "Write failed");
-
-            buffer[0] = (i & FTP_CUST_SECT) | FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-            ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Write failed");
-
-            do
-            {
-                ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "Read failed");
-            } while (buffer[0] & FTP_CUST_REQ);
+            err = ftp_exec(READ, i);
+            if (err == ESP_OK)
+                err = ftp.fetch(image[i], SectorSize);
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGE("STUSB4500", "NVM read failed: %s", esp_err_to_name(err));
+            exit_test_mode(); // au mieux : ne pas laisser la puce en mode test FTP
+            return err;
+        }
 
-            ESP_RETURN_ON_ERROR(read(RW_BUFFER, &sector[i][0], SectorSize), "STUSB4500", "Read failed");
+        {
+            StateLock lock(*this);
+            memcpy(sector, image, sizeof(sector));
+            memcpy(nvm_image, sector, sizeof(nvm_image));
+            nvm_image_valid = true;
+            decode_pdos(sector, pdos);
+            publish_snapshot();
         }
 
         return exit_test_mode();
@@ -92,169 +66,326 @@ namespace stusb4500
 
     esp_err_t STUSB4500::write_sectors(bool use_defaults)
     {
-        if (use_defaults)
-        {
-            memset(sector, DEFAULT, sizeof(sector));
-        }
-        else
-        {
-            // === PDO1 (5V fixe) dans sector[3][2]
-            uint8_t cur1 = encode_current(pdos[0].current);
-            sector[3][2] = (cur1 << 4) | (get_pdo_number() << 1); // bits [7:4]=I, [2:1]=PDO#
-
-            // === PDO2 : Voltage (sector[4][0] + sector[4][1]), Current (sector[3][4])
-            uint16_t v2 = encode_voltage(pdos[1].voltage);
-            sector[4][0] = (v2 & 0x003F) << 2;                                               // bits [7:2] of low 6 bits
-            sector[4][1] = (v2 >> 6) & 0xFF;                                                 // high bits
-            sector[3][4] = (sector[3][4] & 0xF0) | (encode_current(pdos[1].current) & 0x0F); // LSBs
-
-            // === PDO3 : Voltage (sector[4][2] + sector[4][3]), Current (sector[3][5])
-            uint16_t v3 = encode_voltage(pdos[2].voltage);
-            sector[4][2] = v3 & 0xFF;
-            sector[4][3] = (sector[4][3] & 0xFC) | ((v3 >> 8) & 0x03);
-            sector[3][5] = (sector[3][5] & 0x0F) | (encode_current(pdos[2].current) << 4);
-        }
-
-        // Entrée en mode écriture NVM
-        ESP_RETURN_ON_ERROR(enter_write_mode(SECTOR_0 | SECTOR_1 | SECTOR_2 | SECTOR_3 | SECTOR_4), "STUSB4500", "Enter write mode failed");
-
-        // Écriture séquentielle des secteurs
-        for (uint8_t i = 0; i < SectorCount; ++i)
+        STUSB_PROFILE_SCOPE(WriteSectors);
+        SequenceGuard guard(*this);
+        uint8_t pdo_numb = use_defaults ? 0 : get_pdo_number(); // lecture I2C hors verrou d'état
+        uint8_t target[5][8];
         {
-            ESP_RETURN_ON_ERROR(write_sector(i, sector[i]), "STUSB4500", "Write sector failed");
+            StateLock lock(*this); // sector[] modifié en place
+            if (use_defaults)
+            {
+                memset(sector, DEFAULT, sizeof(sector));
+            }
+            else
+            {
+                // PDO1 (5V fixe) : courant + nombre de PDO ; PDO2/PDO3 : tension + courant.
+                // Les autres bits des octets partagés (USB_COMM, EXT_POWER, flex...) sont préservés.
+                nvm::set_fields<nvm::Pdo1Current, nvm::SnkPdoNumb,
+                                nvm::Pdo2Voltage, nvm::Pdo2Current,
+                                nvm::Pdo3Voltage, nvm::Pdo3Current>(
+                    sector,
+                    codec::nvm_current_code(pdos[0].current), pdo_numb,
+                    pdos[1].voltage.value, codec::nvm_current_code(pdos[1].current),
+                    pdos[2].voltage.value, codec::nvm_current_code(pdos[2].current));
+            }
+            memcpy(target, sector, sizeof(target));
         }
 
-        return exit_test_mode();
+        // Seuls les secteurs modifiés sont effacés et reprogrammés
+        return write_sectors_diff(target);
     }
 
     esp_err_t STUSB4500::write_sector(uint8_t sector_num, const uint8_t *data)
     {
-        uint8_t buffer[1];
-
+        STUSB_PROFILE_SCOPE(WriteSector);
         // Étape 1 : écrire les 8 octets à RW_BUFFER
-        ESP_RETURN_ON_ERROR(write(RW_BUFFER, data, SectorSize), "STUSB4500", "Write RW_BUFFER failed");
+        ESP_RETURN_ON_ERROR(ftp.load(data, SectorSize), "STUSB4500", "Write RW_BUFFER failed");
 
-        // Étape 2 : PWR + RST_N
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "CTRL0 failed");
+        // Étape 2 : chargement du page latch (WRITE_PL)
+        ESP_RETURN_ON_ERROR(ftp_exec(WRITE_PL, 0), "STUSB4500", "WRITE_PL failed");
 
-        // Étape 3 : Opcode WRITE_PL
-        buffer[0] = WRITE_PL & FTP_CUST_OPCODE;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "CTRL1 (WRITE_PL) failed");
+        // Étape 3 : programmation du secteur sélectionné
+        ESP_RETURN_ON_ERROR(ftp_exec(PROG_SECTOR, sector_num), "STUSB4500", "PROG_SECTOR failed");
 
-        // Étape 4 : Trigger WRITE_PL
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Trigger WRITE_PL failed");
+        return ESP_OK;
+    }
 
-        do
-        {
-            ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "WAIT WRITE_PL");
-        } while (buffer[0] & FTP_CUST_REQ);
+    esp_err_t STUSB4500::write_default_sectors(const uint8_t custom_sector[5][8])
+    {
+        STUSB_PROFILE_SCOPE(WriteDefaultSectors);
+        return write_sectors_diff(custom_sector);
+    }
+
+    esp_err_t STUSB4500::write_sectors_diff(const uint8_t image[5][8], uint8_t *programmed)
+    {
+        STUSB_PROFILE_SCOPE(WriteSectorsDiff);
+        SequenceGuard guard(*this); // diff calculé sur une image que personne ne modifie
+        if (programmed)
+            *programmed = 0;
 
-        // Étape 5 : Opcode PROG_SECTOR
-        buffer[0] = PROG_SECTOR & FTP_CUST_OPCODE;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "CTRL1 (PROG_SECTOR) failed");
+        // image peut désigner sector[], écrasé par read_sectors()
+        uint8_t target[5][8];
+        memcpy(target, image, sizeof(target));
 
-        // Étape 6 : Trigger PROG_SECTOR avec sélection du secteur
-        buffer[0] = (sector_num & FTP_CUST_SECT) | FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Trigger PROG_SECTOR failed");
+        // L'image de référence est celle de la dernière lecture NVM
+        if (!nvm_image_valid)
+            ESP_RETURN_ON_ERROR(read_sectors(), "STUSB4500", "Read sectors failed");
 
-        do
+        uint8_t mask = dirty_sector_mask(target, nvm_image);
+        if (mask == 0)
         {
-            ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "WAIT PROG_SECTOR");
-        } while (buffer[0] & FTP_CUST_REQ);
+            ESP_LOGD("STUSB4500", "NVM identique, écriture ignorée");
+            return ESP_OK;
+        }
 
+        ESP_RETURN_ON_ERROR(program_sectors(target, mask), "STUSB4500", "Program sectors failed");
+        if (programmed)
+            *programmed = mask;
         return ESP_OK;
     }
 
-    esp_err_t STUSB4500::write_default_sectors(const uint8_t custom_sector[5][8])
+    esp_err_t STUSB4500::program_sectors(const uint8_t image[5][8], uint8_t sectors)
     {
-        ESP_RETURN_ON_ERROR(
-            enter_write_mode(SECTOR_0 | SECTOR_1 | SECTOR_2 | SECTOR_3 | SECTOR_4),
-            "STUSB4500",
-            "Enter write mode failed");
+        STUSB_PROFILE_SCOPE(ProgramSectors);
+        SequenceGuard guard(*this);
+        const uint8_t attempts = program_config.verify ? program_config.retries + 1 : 1;
+        uint8_t pending = sectors;
+        last_program = ProgramPhases{};
 
-        for (uint8_t i = 0; i < 5; ++i)
+        for (uint8_t attempt = 0; attempt < attempts && pending; ++attempt)
         {
-            ESP_RETURN_ON_ERROR(
-                write_sector(i, custom_sector[i]),
-                "STUSB4500",
-                "Write sector failed");
+            // Effacement limité aux secteurs sélectionnés (puis aux seuls échecs de vérification)
+            uint32_t tx = bus_transactions.load(std::memory_order_relaxed);
+            int64_t phase_start = esp_timer_get_time();
+            esp_err_t err = enter_write_mode(pending);
+            if (err != ESP_OK)
+                return abort_program(err, "Enter write mode failed");
+            int64_t phase_end = esp_timer_get_time();
+            last_program.enter_tx += bus_transactions.load(std::memory_order_relaxed) - tx;
+            last_program.enter_us += static_cast<uint32_t>(phase_end - phase_start);
+            tx = bus_transactions.load(std::memory_order_relaxed);
+
+            uint8_t failed = 0;
+            for (uint8_t i = 0; i < SectorCount; ++i)
+            {
+                if (!(pending & (1 << i)))
+                    continue;
+
+                SectorProgramStats &st = sector_program_stats[i];
+                if (attempt > 0)
+                    st.retries++;
+
+                int64_t start = esp_timer_get_time();
+                err = write_sector(i, image[i]);
+                if (err != ESP_OK)
+                    return abort_program(err, "Write sector failed");
+                int64_t programmed = esp_timer_get_time();
+                st.programs++;
+                st.last_program_us = static_cast<uint32_t>(programmed - start);
+                st.max_program_us = std::max(st.max_program_us, st.last_program_us);
+
+                if (program_config.verify)
+                {
+                    bool match = false;
+                    err = verify_sector(i, image[i], match);
+                    if (err != ESP_OK)
+                        return abort_program(err, "Verify failed");
+                    st.last_verify_us = static_cast<uint32_t>(esp_timer_get_time() - programmed);
+                    st.max_verify_us = std::max(st.max_verify_us, st.last_verify_us);
+                    if (!match)
+                    {
+                        st.verify_failures++;
+                        failed |= 1 << i;
+                        continue;
+                    }
+                }
+
+                StateLock lock(*this);
+                memcpy(nvm_image[i], image[i], SectorSize);
+                memcpy(sector[i], image[i], SectorSize);
+            }
+            last_program.program_tx += bus_transactions.load(std::memory_order_relaxed) - tx;
+            last_program.program_us += static_cast<uint32_t>(esp_timer_get_time() - phase_end);
+            pending = failed;
         }
 
-        return exit_test_mode();
+        if (pending)
+        {
+            for (uint8_t i = 0; i < SectorCount; ++i)
+                if (pending & (1 << i))
+                    sector_program_stats[i].unrecovered++;
+            ESP_LOGE("STUSB4500", "Vérification NVM en échec : secteurs 0x%02X", pending);
+        }
+        {
+            StateLock lock(*this);
+            if (pending)
+                nvm_image_valid = false; // contenu des secteurs en échec inconnu
+            decode_pdos(sector, pdos);
+            publish_snapshot();
+        }
+
+        uint32_t tx = bus_transactions.load(std::memory_order_relaxed);
+        int64_t exit_start = esp_timer_get_time();
+        ESP_RETURN_ON_ERROR(exit_test_mode(), "STUSB4500", "Exit test mode failed");
+        last_program.exit_tx = bus_transactions.load(std::memory_order_relaxed) - tx;
+        last_program.exit_us = static_cast<uint32_t>(esp_timer_get_time() - exit_start);
+        return pending ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+    }
+
+    esp_err_t STUSB4500::abort_program(esp_err_t err, const char *what)
+    {
+        // Secteurs peut-être déjà effacés : l'image en cache ne reflète plus la NVM
+        {
+            StateLock lock(*this);
+            nvm_image_valid = false;
+        }
+        ESP_LOGE("STUSB4500", "%s: %s", what, esp_err_to_name(err));
+        exit_test_mode(); // au mieux : ne pas laisser la puce en mode test FTP
+        publish_snapshot();
+        return err;
+    }
+
+    esp_err_t STUSB4500::verify_sector(uint8_t sector_num, const uint8_t *expected, bool &match)
+    {
+        // Relecture dans la même session FTP : READ puis RW_BUFFER en une rafale de 8 octets
+        uint8_t readback[SectorSize];
+        ESP_RETURN_ON_ERROR(ftp_exec(READ, sector_num), "STUSB4500", "READ failed");
+        ESP_RETURN_ON_ERROR(ftp.fetch(readback, SectorSize), "STUSB4500", "Read failed");
+        match = memcmp(readback, expected, SectorSize) == 0;
+        return ESP_OK;
     }
 
     esp_err_t STUSB4500::enter_write_mode(uint8_t erased_sectors)
     {
+        STUSB_PROFILE_SCOPE(EnterWriteMode);
+        SequenceGuard guard(*this);
         uint8_t buffer[1];
 
-        // Étape 1 : mot de passe
-        buffer[0] = FTP_CUST_PASSWORD;
-        ESP_RETURN_ON_ERROR(write(FTP_CUST_PASSWORD_REG, buffer, 1), "STUSB4500", "Password failed");
+        // Étape 1 : mot de passe + reset interne du contrôleur
+        ESP_RETURN_ON_ERROR(ftp_unlock(), "STUSB4500", "Unlock failed");
 
         // Étape 2 : Préparer RW_BUFFER (partiel efface = 0)
         buffer[0] = 0x00;
-        ESP_RETURN_ON_ERROR(write(RW_BUFFER, buffer, 1), "STUSB4500", "RW_BUFFER reset failed");
+        ESP_RETURN_ON_ERROR(ftp.load(buffer, 1), "STUSB4500", "RW_BUFFER reset failed");
 
-        // Étape 3 : Reset interne du contrôleur
-        buffer[0] = 0x00;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "CTRL0 reset failed");
+        // Étape 3 : opcode WRITE_SER avec sélection de secteur(s)
+        uint8_t ser = (erased_sectors << 3) & FTP_CUST_SER;
+        ESP_RETURN_ON_ERROR(ftp_exec(ser | WRITE_SER, 0), "STUSB4500", "WRITE_SER failed");
 
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "CTRL0 power/reset failed");
+        // Étape 4 : Soft programming
+        ESP_RETURN_ON_ERROR(ftp_exec(SOFT_PROG_SECTOR, 0), "STUSB4500", "SOFT_PROG_SECTOR failed");
 
-        // Étape 4 : Écriture de l’opcode WRITE_SER avec sélection de secteur(s)
-        buffer[0] = ((erased_sectors << 3) & FTP_CUST_SER) | (WRITE_SER & FTP_CUST_OPCODE);
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "CTRL1 opcode write failed");
+        // Étape 5 : Effacement des secteurs (obligatoire avant prog)
+        ESP_RETURN_ON_ERROR(ftp_exec(ERASE_SECTOR, 0), "STUSB4500", "ERASE_SECTOR failed");
 
-        // Étape 5 : Lancer la commande WRITE_SER
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "REQ failed");
+        return ESP_OK;
+    }
 
-        // Attente fin d'exécution
-        do
-        {
-            ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "CTRL0 read failed");
-        } while (buffer[0] & FTP_CUST_REQ);
+    esp_err_t STUSB4500::exit_test_mode()
+    {
+        STUSB_PROFILE_SCOPE(ExitTestMode);
+        SequenceGuard guard(*this);
+        ESP_RETURN_ON_ERROR(ftp.lock(), "STUSB4500", "Exit test mode failed");
+        return ESP_OK;
+    }
 
-        // Étape 6 : Soft programming
-        buffer[0] = SOFT_PROG_SECTOR & FTP_CUST_OPCODE;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "Soft prog opcode failed");
+    esp_err_t STUSB4500::ftp_unlock()
+    {
+        return ftp.unlock();
+    }
 
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Soft prog exec failed");
+    esp_err_t STUSB4500::ftp_exec(uint8_t ctrl1, uint8_t sector_num)
+    {
+        // Le déclenchement (REQ) est écrit séparément : il doit suivre l'écriture de l'opcode
+        ESP_RETURN_ON_ERROR(ftp.request(ctrl1, sector_num), "STUSB4500", "FTP request failed");
+        return ftp_wait(ctrl1 & FTP_CUST_OPCODE);
+    }
 
-        do
-        {
-            ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "Soft prog wait failed");
-        } while (buffer[0] & FTP_CUST_REQ);
+    esp_err_t STUSB4500::ftp_wait(uint8_t opcode)
+    {
+        FtpStats &stats = ftp_stats[opcode & FTP_CUST_OPCODE];
+        const bool long_op = ftp_is_long_op(opcode);
+        const uint32_t timeout_us = long_op ? FtpLongTimeoutUs : FtpShortTimeoutUs;
+        const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
 
-        // Étape 7 : Effacement des secteurs (obligatoire avant prog)
-        buffer[0] = ERASE_SECTOR & FTP_CUST_OPCODE;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_1, buffer, 1), "STUSB4500", "Erase opcode failed");
+        if (stats.expected_us == 0)
+            stats.expected_us = long_op ? FtpLongInitialUs : FtpShortInitialUs;
 
-        buffer[0] = FTP_CUST_PWR | FTP_CUST_RST_N | FTP_CUST_REQ;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "Erase exec failed");
+        int64_t start = esp_timer_get_time();
+        bool pending = true;
+        uint32_t elapsed = 0;
+        uint32_t polls = 0;
 
-        do
+        while (true)
         {
-            ESP_RETURN_ON_ERROR(read(FTP_CTRL_0, buffer, 1), "STUSB4500", "Erase wait failed");
-        } while (buffer[0] & FTP_CUST_REQ);
+            // On dort jusqu'à la fin estimée (au moins 1/8 de l'estimation entre deux lectures)
+            uint32_t remaining = stats.expected_us > elapsed ? stats.expected_us - elapsed : 0;
+            uint32_t wait_us = remaining > stats.expected_us / 8 ? remaining : stats.expected_us / 8;
+            // Effacement et programmation durent plusieurs ms : au moins un tick de sommeil.
+            // READ, WRITE_PL : attente active bornée plutôt qu'un tick entier
+            if (long_op || wait_us > FtpMaxBusyWaitUs)
+                vTaskDelay(wait_us >= tick_us ? wait_us / tick_us : 1);
+            else
+                esp_rom_delay_us(wait_us);
+
+            ESP_RETURN_ON_ERROR(ftp.busy(pending), "STUSB4500", "CTRL0 read failed");
+            polls++;
+            elapsed = static_cast<uint32_t>(esp_timer_get_time() - start);
+
+            if (!pending)
+                break;
+
+            if (elapsed >= timeout_us)
+            {
+                stats.timeouts++;
+                stats.polls += polls;
+                ESP_LOGE("STUSB4500", "FTP opcode %u : délai dépassé (%lu us)", opcode, (unsigned long)elapsed);
+                return ESP_ERR_TIMEOUT;
+            }
+        }
+
+        stats.count++;
+        stats.polls += polls;
+        stats.total_us += elapsed;
+        if (elapsed < stats.min_us)
+            stats.min_us = elapsed;
+        if (elapsed > stats.max_us)
+            stats.max_us = elapsed;
+
+        int bucket = 0;
+        while (bucket < FtpStats::Buckets - 1 && (elapsed >> (bucket + 1)) != 0)
+            bucket++;
+        stats.histogram[bucket]++;
+
+        // Terminé dès la première lecture : l'estimation est trop longue, on la réduit.
+        // Sinon elle se rapproche de la latence observée.
+        if (polls == 1)
+            stats.expected_us -= stats.expected_us / 8;
+        else if (elapsed > stats.expected_us)
+            stats.expected_us += (elapsed - stats.expected_us) / 4;
 
         return ESP_OK;
     }
 
-    esp_err_t STUSB4500::exit_test_mode()
+    FtpStats STUSB4500::get_ftp_stats(uint8_t opcode) const
     {
-        uint8_t buffer[1];
+        return ftp_stats[opcode & FTP_CUST_OPCODE];
+    }
 
-        buffer[0] = FTP_CUST_RST_N;
-        ESP_RETURN_ON_ERROR(write(FTP_CTRL_0, buffer, 1), "STUSB4500", "CTRL0 reset");
+    void STUSB4500::reset_ftp_stats()
+    {
+        for (auto &stats : ftp_stats)
+            stats = FtpStats{};
+    }
 
-        buffer[0] = 0x00;
-        ESP_RETURN_ON_ERROR(write(FTP_CUST_PASSWORD_REG, buffer, 1), "STUSB4500", "Clear password");
+    SectorProgramStats STUSB4500::get_sector_program_stats(uint8_t sector_num) const
+    {
+        return sector_num < SectorCount ? sector_program_stats[sector_num] : SectorProgramStats{};
+    }
 
-        return ESP_OK;
+    void STUSB4500::reset_sector_program_stats()
+    {
+        for (auto &stats : sector_program_stats)
+            stats = SectorProgramStats{};
     }
 }
\ No newline at end of file
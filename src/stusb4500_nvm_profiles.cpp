@@ -0,0 +1,307 @@
+#include "stusb4500_internal.hpp"
+#include "stusb4500_nvm_profiles.hpp"
+#include <cstdio>
+#include <cstring>
+#include <esp_check.h>
+
+namespace
+{
+    constexpr uint8_t Magic[4] = {'S', 'P', 'R', 'F'};
+    constexpr uint8_t FormatVersion = 1;
+    constexpr size_t ImageSize = 40;
+
+    // CRC-32 (polynôme réfléchi 0xEDB88320), bit à bit : quelques profils seulement
+    uint32_t crc32(uint32_t crc, const uint8_t *data, size_t len)
+    {
+        crc = ~crc;
+        for (size_t i = 0; i < len; ++i)
+        {
+            crc ^= data[i];
+            for (int b = 0; b < 8; ++b)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+        return ~crc;
+    }
+
+    using stusb4500::NvmProfile;
+
+    constexpr size_t HeaderSize = sizeof(Magic) + 2;
+
+    size_t write_header(uint8_t *out, size_t count)
+    {
+        memcpy(out, Magic, sizeof(Magic));
+        out[4] = FormatVersion;
+        out[5] = static_cast<uint8_t>(count);
+        return HeaderSize;
+    }
+
+    esp_err_t check_header(const uint8_t *data, size_t &count)
+    {
+        if (memcmp(data, Magic, sizeof(Magic)) != 0)
+            return ESP_ERR_INVALID_ARG;
+        if (data[4] != FormatVersion)
+            return ESP_ERR_NOT_SUPPORTED;
+        count = data[5];
+        return count > stusb4500::ProfileStore::MaxProfiles ? ESP_ERR_INVALID_SIZE : ESP_OK;
+    }
+
+    bool record_fits(uint8_t name_len)
+    {
+        return name_len != 0 && name_len <= NvmProfile::MaxName;
+    }
+
+    // Longueur du nom, nom (sans zéro final), image et CRC-32 petit-boutiste
+    size_t write_record(const NvmProfile &p, uint8_t *out)
+    {
+        uint8_t len = static_cast<uint8_t>(strlen(p.name));
+        size_t n = 0;
+        out[n++] = len;
+        memcpy(&out[n], p.name, len);
+        n += len;
+        memcpy(&out[n], p.image, ImageSize);
+        n += ImageSize;
+        for (int b = 0; b < 4; ++b)
+            out[n++] = static_cast<uint8_t>(p.checksum >> (8 * b));
+        return n;
+    }
+
+    // Corps d'un enregistrement (après l'octet de longueur) ; CRC vérifié
+    esp_err_t read_record(const uint8_t *body, uint8_t name_len, NvmProfile &p)
+    {
+        memcpy(p.name, body, name_len);
+        memcpy(p.image, &body[name_len], ImageSize);
+        p.checksum = stusb4500::le32(&body[name_len + ImageSize]);
+        if (!p.valid())
+        {
+            ESP_LOGW("STUSB4500", "Profil \"%s\" : checksum invalide", p.name);
+            return ESP_ERR_INVALID_CRC;
+        }
+        return ESP_OK;
+    }
+}
+
+namespace stusb4500
+{
+    uint32_t NvmProfile::compute_checksum() const
+    {
+        uint32_t crc = crc32(0, reinterpret_cast<const uint8_t *>(name), strlen(name));
+        return crc32(crc, &image[0][0], ImageSize);
+    }
+
+    uint8_t profile_diff(const NvmProfile &profile, const uint8_t image[5][8])
+    {
+        return dirty_sector_mask(profile.image, image);
+    }
+
+    // === Magasin ===
+
+    esp_err_t ProfileStore::add(const char *name, const uint8_t image[5][8])
+    {
+        size_t len = name ? strlen(name) : 0;
+        if (len == 0 || len > NvmProfile::MaxName)
+            return ESP_ERR_INVALID_ARG;
+
+        NvmProfile p;
+        memcpy(p.name, name, len);
+        memcpy(p.image, image, ImageSize);
+        p.checksum = p.compute_checksum();
+
+        for (NvmProfile &existing : profiles)
+        {
+            if (strcmp(existing.name, name) == 0)
+            {
+                existing = p;
+                return ESP_OK;
+            }
+        }
+        if (profiles.size() >= MaxProfiles)
+            return ESP_ERR_NO_MEM;
+        profiles.push_back(p);
+        return ESP_OK;
+    }
+
+    bool ProfileStore::remove(const char *name)
+    {
+        for (auto it = profiles.begin(); it != profiles.end(); ++it)
+        {
+            if (strcmp(it->name, name) == 0)
+            {
+                profiles.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const NvmProfile *ProfileStore::find(const char *name) const
+    {
+        for (const NvmProfile &p : profiles)
+            if (strcmp(p.name, name) == 0)
+                return &p;
+        return nullptr;
+    }
+
+    size_t ProfileStore::encoded_size() const
+    {
+        size_t size = HeaderSize;
+        for (const NvmProfile &p : profiles)
+            size += 1 + strlen(p.name) + ImageSize + 4;
+        return size;
+    }
+
+    size_t ProfileStore::encode(uint8_t *out, size_t max) const
+    {
+        if (encoded_size() > max)
+            return 0;
+
+        size_t n = write_header(out, profiles.size());
+        for (const NvmProfile &p : profiles)
+            n += write_record(p, &out[n]);
+        return n;
+    }
+
+    esp_err_t ProfileStore::decode(const uint8_t *data, size_t len)
+    {
+        if (len < HeaderSize)
+            return ESP_ERR_INVALID_ARG;
+        size_t count = 0;
+        esp_err_t err = check_header(data, count);
+        if (err != ESP_OK)
+            return err;
+
+        // Décodage complet avant remplacement : un fichier corrompu laisse le magasin intact
+        std::vector<NvmProfile> loaded;
+        loaded.reserve(count);
+        size_t n = HeaderSize;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (n >= len)
+                return ESP_ERR_INVALID_SIZE;
+            uint8_t name_len = data[n++];
+            if (!record_fits(name_len) || n + name_len + ImageSize + 4 > len)
+                return ESP_ERR_INVALID_SIZE;
+
+            NvmProfile p;
+            err = read_record(&data[n], name_len, p);
+            if (err != ESP_OK)
+                return err;
+            n += name_len + ImageSize + 4;
+            loaded.push_back(p);
+        }
+
+        profiles = std::move(loaded);
+        return ESP_OK;
+    }
+
+    esp_err_t ProfileStore::save(ProfileBackend &backend) const
+    {
+        ESP_RETURN_ON_ERROR(backend.open(true), "STUSB4500", "Profile open failed");
+
+        uint8_t record[MaxRecordSize];
+        esp_err_t err = backend.write(record, write_header(record, profiles.size()));
+        for (size_t i = 0; err == ESP_OK && i < profiles.size(); ++i)
+            err = backend.write(record, write_record(profiles[i], record));
+
+        esp_err_t closed = backend.close();
+        return err != ESP_OK ? err : closed;
+    }
+
+    esp_err_t ProfileStore::load(ProfileBackend &backend)
+    {
+        ESP_RETURN_ON_ERROR(backend.open(false), "STUSB4500", "Profile open failed");
+
+        uint8_t record[MaxRecordSize];
+        size_t count = 0;
+        esp_err_t err = backend.read(record, HeaderSize);
+        if (err == ESP_OK)
+            err = check_header(record, count);
+
+        // Même règle que decode() : le magasin n'est remplacé qu'après lecture complète
+        std::vector<NvmProfile> loaded;
+        if (err == ESP_OK)
+            loaded.reserve(count);
+        for (size_t i = 0; err == ESP_OK && i < count; ++i)
+        {
+            uint8_t name_len = 0;
+            err = backend.read(&name_len, 1);
+            if (err == ESP_OK && !record_fits(name_len))
+                err = ESP_ERR_INVALID_SIZE;
+            if (err == ESP_OK)
+                err = backend.read(record, name_len + ImageSize + 4);
+
+            NvmProfile p;
+            if (err == ESP_OK)
+                err = read_record(record, name_len, p);
+            if (err == ESP_OK)
+                loaded.push_back(p);
+        }
+
+        backend.close();
+        if (err != ESP_OK)
+            return err;
+        profiles = std::move(loaded);
+        return ESP_OK;
+    }
+
+    // === Fichier ===
+
+    esp_err_t FileProfileBackend::open(bool for_write)
+    {
+        close();
+        file = fopen(path, for_write ? "wb" : "rb");
+        return file ? ESP_OK : ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t FileProfileBackend::read(uint8_t *data, size_t len)
+    {
+        if (!file)
+            return ESP_ERR_INVALID_STATE;
+        if (fread(data, 1, len, file) != len)
+            return ferror(file) ? ESP_FAIL : ESP_ERR_INVALID_SIZE;
+        return ESP_OK;
+    }
+
+    esp_err_t FileProfileBackend::write(const uint8_t *data, size_t len)
+    {
+        if (!file)
+            return ESP_ERR_INVALID_STATE;
+        return fwrite(data, 1, len, file) == len ? ESP_OK : ESP_FAIL;
+    }
+
+    esp_err_t FileProfileBackend::close()
+    {
+        if (!file)
+            return ESP_OK;
+        bool failed = fclose(file) != 0;
+        file = nullptr;
+        return failed ? ESP_FAIL : ESP_OK;
+    }
+
+    // === Application sur la puce ===
+
+    esp_err_t STUSB4500::diff_nvm_profile(const NvmProfile &profile, uint8_t &sectors)
+    {
+        SequenceGuard guard(*this); // nvm_image n'est pas réécrite pendant la comparaison
+        if (!nvm_image_valid)
+            return ESP_ERR_INVALID_STATE; // contenu NVM inconnu : read_sectors() d'abord
+        sectors = profile_diff(profile, nvm_image);
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::apply_nvm_profile(const NvmProfile &profile, uint8_t *programmed)
+    {
+        STUSB_PROFILE_SCOPE(ApplyNvmProfile);
+        if (programmed)
+            *programmed = 0;
+        STUSB_CHECK_AVAILABLE_RET(ESP_ERR_INVALID_STATE);
+
+        if (!profile.valid())
+        {
+            ESP_LOGE("STUSB4500", "Profil \"%s\" : checksum invalide, programmation refusée", profile.name);
+            return ESP_ERR_INVALID_CRC;
+        }
+
+        // Seuls les secteurs différents de la NVM actuelle sont effacés et reprogrammés
+        return write_sectors_diff(profile.image, programmed);
+    }
+}
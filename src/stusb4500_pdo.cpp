@@ -5,6 +5,8 @@ namespace stusb4500
 {
     esp_err_t STUSB4500::soft_reset()
     {
+        STUSB_PROFILE_SCOPE(SoftReset);
+        SequenceGuard guard(*this);
         uint8_t buffer[1];
 
         buffer[0] = 0x0D; // SOFT_RESET Command
@@ -13,29 +15,37 @@ namespace stusb4500
         buffer[0] = 0x26; // SEND_COMMAND
         ESP_RETURN_ON_ERROR(write(PD_COMMAND_CTRL, buffer, 1), "STUSB4500", "PD_COMMAND_CTRL failed");
 
+        begin_renegotiation();
         return ESP_OK;
     }
 
     esp_err_t STUSB4500::read_pdo(uint8_t pdo_numb, uint32_t& out_pdo) {
+        STUSB_PROFILE_SCOPE(ReadPdo);
         if (pdo_numb < 1 || pdo_numb > 3) return ESP_ERR_INVALID_ARG;
+
+        taskENTER_CRITICAL(&shadow_lock);
+        bool cached = shadow.valid & (1u << (pdo_numb - 1));
+        if (cached)
+            out_pdo = shadow.pdo[pdo_numb - 1];
+        taskEXIT_CRITICAL(&shadow_lock);
+        if (cached)
+            return ESP_OK;
     
         uint8_t buffer[4];
-        uint8_t reg = 0x85 + (pdo_numb - 1) * 4;
+        uint8_t reg = DPM_SNK_PDO1 + (pdo_numb - 1) * 4;
     
         esp_err_t err = read(reg, buffer, sizeof(buffer));
         if (err != ESP_OK) return err;
     
-        out_pdo = (uint32_t)buffer[0] |
-                  ((uint32_t)buffer[1] << 8) |
-                  ((uint32_t)buffer[2] << 16) |
-                  ((uint32_t)buffer[3] << 24);
+        out_pdo = le32(buffer);
         return ESP_OK;
     }
     
     esp_err_t STUSB4500::write_pdo(uint8_t pdo_numb, uint32_t pdo_data) {
+        STUSB_PROFILE_SCOPE(WritePdo);
         if (pdo_numb < 1 || pdo_numb > 3) return ESP_ERR_INVALID_ARG;
     
-        uint8_t reg = 0x85 + (pdo_numb - 1) * 4;
+        uint8_t reg = DPM_SNK_PDO1 + (pdo_numb - 1) * 4;
         uint8_t buffer[4] = {
             static_cast<uint8_t>(pdo_data & 0xFF),
             static_cast<uint8_t>((pdo_data >> 8) & 0xFF),
@@ -43,6 +53,136 @@ namespace stusb4500
             static_cast<uint8_t>((pdo_data >> 24) & 0xFF)
         };
     
-        return write(reg, buffer, sizeof(buffer));
+        esp_err_t err = write(reg, buffer, sizeof(buffer));
+        if (err == ESP_OK)
+            mark_pdo_write();
+        return err;
+    }
+
+    esp_err_t STUSB4500::read_pdos(uint32_t out_pdos[3])
+    {
+        STUSB_PROFILE_SCOPE(ReadPdos);
+        if (shadow_pdos(out_pdos))
+            return ESP_OK;
+
+        // Décodé depuis le tampon : les trois mots viennent du même transfert
+        uint8_t buffer[12];
+        ESP_RETURN_ON_ERROR(read(DPM_SNK_PDO1, buffer, sizeof(buffer)), "STUSB4500", "PDO read failed");
+        for (int i = 0; i < 3; ++i)
+            out_pdos[i] = le32(&buffer[i * 4]);
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::write_pdos(const uint32_t pdos[3], uint8_t count)
+    {
+        STUSB_PROFILE_SCOPE(WritePdos);
+        if (count < 1 || count > 3)
+            return ESP_ERR_INVALID_ARG;
+
+        uint8_t buffer[12];
+        for (uint8_t i = 0; i < count; ++i)
+            for (int b = 0; b < 4; ++b)
+                buffer[i * 4 + b] = static_cast<uint8_t>(pdos[i] >> (8 * b));
+
+        // Une seule écriture : la puce ne voit jamais un jeu de PDO à moitié modifié
+        ESP_RETURN_ON_ERROR(write(DPM_SNK_PDO1, buffer, count * 4), "STUSB4500", "PDO write failed");
+        mark_pdo_write();
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::read_pdos(SinkPdo out_pdos[3])
+    {
+        uint32_t raw[3];
+        ESP_RETURN_ON_ERROR(read_pdos(raw), "STUSB4500", "PDO read failed");
+        for (int i = 0; i < 3; ++i)
+            out_pdos[i] = SinkPdo::decode(raw[i]);
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::write_pdos(const SinkPdo pdos[3], uint8_t count)
+    {
+        if (count < 1 || count > 3)
+            return ESP_ERR_INVALID_ARG;
+
+        uint32_t raw[3] = {};
+        for (uint8_t i = 0; i < count; ++i)
+            raw[i] = pdos[i].encode();
+        return write_pdos(raw, count);
+    }
+
+    uint32_t STUSB4500::shadow_epoch() const
+    {
+        taskENTER_CRITICAL(&shadow_lock);
+        uint32_t epoch = shadow.epoch;
+        taskEXIT_CRITICAL(&shadow_lock);
+        return epoch;
+    }
+
+    bool STUSB4500::shadow_pdos(uint32_t out[3]) const
+    {
+        constexpr uint8_t AllPdos = 0x07;
+        taskENTER_CRITICAL(&shadow_lock);
+        bool cached = (shadow.valid & AllPdos) == AllPdos;
+        if (cached)
+            for (int i = 0; i < 3; ++i)
+                out[i] = shadow.pdo[i];
+        taskEXIT_CRITICAL(&shadow_lock);
+        return cached;
+    }
+
+    bool STUSB4500::shadow_pdo_numb(uint8_t &numb) const
+    {
+        taskENTER_CRITICAL(&shadow_lock);
+        bool cached = shadow.valid & ShadowPdoNumb;
+        if (cached)
+            numb = shadow.pdo_numb;
+        taskEXIT_CRITICAL(&shadow_lock);
+        return cached;
+    }
+
+    void STUSB4500::invalidate_shadow()
+    {
+        taskENTER_CRITICAL(&shadow_lock);
+        shadow.valid = 0;
+        shadow.epoch++;
+        taskEXIT_CRITICAL(&shadow_lock);
+    }
+
+    void STUSB4500::shadow_store(uint8_t reg, const uint8_t *data, size_t len, const uint32_t *read_epoch)
+    {
+        const size_t end = reg + len;
+
+        taskENTER_CRITICAL(&shadow_lock);
+        if (read_epoch && *read_epoch != shadow.epoch)
+        {
+            // Écriture ou invalidation pendant la lecture : valeurs lues peut-être périmées
+            taskEXIT_CRITICAL(&shadow_lock);
+            return;
+        }
+        if (!read_epoch)
+            shadow.epoch++;
+
+        if (reg <= DPM_PDO_NUMB && end > DPM_PDO_NUMB)
+        {
+            shadow.pdo_numb = data[DPM_PDO_NUMB - reg] & 0x07;
+            shadow.valid |= ShadowPdoNumb;
+        }
+
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            const size_t first = DPM_SNK_PDO1 + i * 4;
+            if (end <= first || reg >= first + 4)
+                continue;
+            if (reg <= first && end >= first + 4)
+            {
+                shadow.pdo[i] = le32(&data[first - reg]);
+                shadow.valid |= 1u << i;
+            }
+            else
+            {
+                shadow.valid &= ~(1u << i); // accès partiel : mot incomplet
+            }
+        }
+        taskEXIT_CRITICAL(&shadow_lock);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,203 @@
+#include "stusb4500_internal.hpp"
+#include <esp_check.h>
+#include <esp_timer.h>
+
+namespace
+{
+    using namespace stusb4500;
+
+    constexpr uint8_t MsgTypeSourceCapabilities = 0x01; // message de données
+    constexpr uint8_t MsgTypePsRdy = 0x06;              // message de contrôle : contrat établi
+    constexpr uint32_t SafeVoltageMv = 5000;
+
+    struct Candidate
+    {
+        uint32_t mv = 0;
+        uint32_t ma = 0;
+        uint32_t mw = 0;
+        bool meets_target = false;
+    };
+
+    // Tension et courant arrondis au pas du champ (codec::), drapeaux à zéro
+    uint32_t fixed_pdo(uint32_t mv, uint32_t ma)
+    {
+        return SinkPdo{Millivolts(mv), Milliamps(ma)}.encode();
+    }
+
+    // true si a est préférable à b
+    bool better(const Candidate &a, const Candidate &b, bool has_target)
+    {
+        if (has_target && a.meets_target != b.meets_target)
+            return a.meets_target;
+        if (has_target && a.meets_target)
+            return a.mv < b.mv; // puissance atteinte : la tension la plus basse
+        if (a.mw != b.mw)
+            return a.mw > b.mw;
+        return a.mv < b.mv;
+    }
+}
+
+namespace stusb4500
+{
+    SinkPdoSet select_sink_pdos(const SourceCapabilities &caps, const PowerPolicy &policy)
+    {
+        const uint32_t min_mv = static_cast<uint32_t>(policy.min_voltage * 1000.0f + 0.5f);
+        const uint32_t max_mv = static_cast<uint32_t>(policy.max_voltage * 1000.0f + 0.5f);
+        const uint32_t limit_ma = static_cast<uint32_t>(policy.max_current * 1000.0f + 0.5f);
+        const uint32_t target_mw = static_cast<uint32_t>(policy.target_power * 1000.0f + 0.5f);
+        const bool has_target = target_mw > 0;
+
+        Candidate best, fallback;
+        uint32_t safe_ma = 0;
+        bool found = false;
+
+        for (uint8_t i = 0; i < caps.count && i < SourceCapabilities::MaxObjects; ++i)
+        {
+            uint32_t pdo = caps.pdo[i];
+            if (!pdo_is_fixed(pdo)) // le STUSB4500 ne négocie que des PDO fixes
+                continue;
+
+            const SinkPdo offer = SinkPdo::decode(pdo);
+            Candidate c;
+            c.mv = offer.voltage.value;
+            c.ma = offer.current.value;
+            if (c.ma > limit_ma)
+                c.ma = limit_ma;
+            if (c.mv == SafeVoltageMv)
+                safe_ma = c.ma;
+            if (c.mv < min_mv || c.mv > max_mv || c.ma == 0)
+                continue;
+
+            if (has_target)
+            {
+                // Courant juste suffisant, arrondi au pas de 10 mA
+                uint32_t needed = (static_cast<uint64_t>(target_mw) * 1000 + c.mv - 1) / c.mv;
+                needed = (needed + 9) / 10 * 10;
+                if (needed <= c.ma)
+                {
+                    c.ma = needed;
+                    c.meets_target = true;
+                }
+            }
+            c.mw = c.mv * c.ma / 1000;
+
+            if (!found || better(c, best, has_target))
+            {
+                if (found && best.mv != SafeVoltageMv)
+                    fallback = best;
+                best = c;
+                found = true;
+            }
+            else if (c.mv != SafeVoltageMv && (fallback.mv == 0 || better(c, fallback, has_target)))
+            {
+                fallback = c;
+            }
+        }
+
+        SinkPdoSet set;
+        if (!found)
+            return set;
+
+        if (best.mv == SafeVoltageMv)
+        {
+            set.count = 1;
+            set.pdo[0] = fixed_pdo(best.mv, best.ma);
+            return set;
+        }
+
+        // PDO1 (5 V) reste obligatoire ; le choix préféré occupe le rang le plus élevé
+        set.pdo[set.count++] = fixed_pdo(SafeVoltageMv, safe_ma ? safe_ma : best.ma);
+        if (fallback.mv != 0 && fallback.mv != best.mv)
+            set.pdo[set.count++] = fixed_pdo(fallback.mv, fallback.ma);
+        set.pdo[set.count++] = fixed_pdo(best.mv, best.ma);
+        return set;
+    }
+
+    esp_err_t STUSB4500::capture_source_capabilities(SourceCapabilities &caps, bool &ps_ready)
+    {
+        uint8_t prt;
+        ESP_RETURN_ON_ERROR(read(PRT_STATUS, &prt, 1), "STUSB4500", "PRT_STATUS read failed");
+        if (!(prt & PRT_STATUS_MSG_RECEIVED))
+            return ESP_OK;
+
+        // RX_HEADER (2 octets) puis RX_DATA_OBJ1..7 : une seule lecture en rafale
+        uint8_t rx[2 + SourceCapabilities::MaxObjects * 4];
+        ESP_RETURN_ON_ERROR(read(RX_HEADER_LOW, rx, sizeof(rx)), "STUSB4500", "RX buffer read failed");
+
+        uint16_t header = rx[0] | (rx[1] << 8);
+        uint8_t objects = (header >> 12) & 0x07;
+        ps_ready = objects == 0 && (header & 0x1F) == MsgTypePsRdy;
+        if ((header & 0x1F) != MsgTypeSourceCapabilities || objects == 0)
+            return ESP_OK; // message de contrôle ou autre message de données
+
+        caps = SourceCapabilities{};
+        caps.timestamp_us = esp_timer_get_time();
+        caps.count = objects;
+        for (uint8_t i = 0; i < objects; ++i)
+            caps.pdo[i] = le32(&rx[2 + i * 4]);
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::apply_sink_pdos(const SinkPdoSet &set)
+    {
+        STUSB_PROFILE_SCOPE(ApplySinkPdos);
+        if (set.count < 1 || set.count > 3)
+            return ESP_ERR_INVALID_ARG;
+
+        // PDO, DPM_PDO_NUMB et SOFT_RESET d'un seul tenant
+        SequenceGuard guard(*this);
+
+        // Seuls tension et courant changent : les drapeaux (USB comm, alimentation
+        // non contrainte, double rôle, FRS) des PDO en place sont conservés
+        SinkPdo current[3];
+        ESP_RETURN_ON_ERROR(read_pdos(current), "STUSB4500", "PDO read failed");
+        uint8_t numb = 0;
+        if (!shadow_pdo_numb(numb))
+            ESP_RETURN_ON_ERROR(read(DPM_PDO_NUMB, &numb, 1), "STUSB4500", "DPM_PDO_NUMB read failed");
+
+        SinkPdo next[3];
+        bool same = (numb & 0x07) == set.count;
+        for (uint8_t i = 0; i < set.count; ++i)
+        {
+            const SinkPdo wanted = SinkPdo::decode(set.pdo[i]);
+            next[i] = current[i];
+            next[i].voltage = wanted.voltage;
+            next[i].current = wanted.current;
+            same = same && next[i].encode() == current[i].encode();
+        }
+
+        // Jeu déjà en place : pas de renégociation
+        if (same)
+            return ESP_OK;
+
+        // DPM_SNK_PDO1..n en une écriture, puis le nombre de PDO et une seule renégociation.
+        // volatile_regs et pdos[] restent à la synchronisation (relecture après renégociation)
+        ESP_RETURN_ON_ERROR(write_pdos(next, set.count), "STUSB4500", "PDO write failed");
+
+        numb = set.count;
+        ESP_RETURN_ON_ERROR(write(DPM_PDO_NUMB, &numb, 1), "STUSB4500", "DPM_PDO_NUMB write failed");
+        ESP_RETURN_ON_ERROR(soft_reset(), "STUSB4500", "Soft reset failed");
+        return ESP_OK;
+    }
+
+    esp_err_t STUSB4500::apply_power_policy(const PowerPolicy &policy)
+    {
+        STUSB_PROFILE_SCOPE(ApplyPowerPolicy);
+        STUSB_CHECK_AVAILABLE_RET(ESP_ERR_INVALID_STATE);
+
+        const Snapshot snap = get_snapshot();
+        if (snap.source.count == 0)
+        {
+            ESP_LOGW("STUSB4500", "Capacités source inconnues");
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        SinkPdoSet set = select_sink_pdos(snap.source, policy);
+        if (set.count == 0)
+        {
+            ESP_LOGW("STUSB4500", "Aucun PDO source compatible avec la politique");
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        return apply_sink_pdos(set);
+    }
+}
@@ -0,0 +1,66 @@
+#include "stusb4500_internal.hpp"
+
+namespace stusb4500
+{
+    const char *profile_api_name(ProfileApi api)
+    {
+        static const char *const names[] = {
+#define STUSB4500_PROFILE_NAME(id, name) name,
+            STUSB4500_PROFILE_APIS(STUSB4500_PROFILE_NAME)
+#undef STUSB4500_PROFILE_NAME
+        };
+        size_t index = static_cast<size_t>(api);
+        return index < static_cast<size_t>(ProfileApi::Count) ? names[index] : "?";
+    }
+
+#if CONFIG_STUSB4500_PROFILING
+
+    thread_local ProfileApi ProfileScope::current = ProfileApi::Other;
+
+    void STUSB4500::profile_transaction(size_t len, esp_err_t err, uint32_t elapsed_us)
+    {
+        ApiProfile &p = api_profiles[static_cast<size_t>(ProfileScope::active())];
+
+        taskENTER_CRITICAL(&profile_lock);
+        p.transactions++;
+        p.bytes += len;
+        p.total_us += elapsed_us;
+        if (elapsed_us > p.max_us)
+            p.max_us = elapsed_us;
+        if (err != ESP_OK)
+            p.errors++;
+        taskEXIT_CRITICAL(&profile_lock);
+    }
+
+    ApiProfile STUSB4500::get_api_profile(ProfileApi api) const
+    {
+        if (api >= ProfileApi::Count)
+            return ApiProfile{};
+
+        taskENTER_CRITICAL(&profile_lock);
+        ApiProfile p = api_profiles[static_cast<size_t>(api)];
+        taskEXIT_CRITICAL(&profile_lock);
+        return p;
+    }
+
+    void STUSB4500::reset_api_profiles()
+    {
+        taskENTER_CRITICAL(&profile_lock);
+        for (auto &p : api_profiles)
+            p = ApiProfile{};
+        taskEXIT_CRITICAL(&profile_lock);
+    }
+
+#else
+
+    ApiProfile STUSB4500::get_api_profile(ProfileApi) const
+    {
+        return ApiProfile{};
+    }
+
+    void STUSB4500::reset_api_profiles()
+    {
+    }
+
+#endif
+}
@@ -0,0 +1,133 @@
+#include "stusb4500_internal.hpp"
+#include <esp_timer.h>
+
+namespace
+{
+    enum Phase
+    {
+        PdoToReset,
+        ResetToAlert,
+        AlertToRdo,
+        Total,
+    };
+
+    uint32_t now_us()
+    {
+        return static_cast<uint32_t>(esp_timer_get_time());
+    }
+}
+
+namespace stusb4500
+{
+    void STUSB4500::mark_pdo_write()
+    {
+        // Seule la première écriture avant SOFT_RESET ouvre la mesure
+        taskENTER_CRITICAL(&reneg_lock);
+        if (!reneg.pdo_written)
+        {
+            reneg.start_us = now_us();
+            reneg.pdo_written = true;
+        }
+        taskEXIT_CRITICAL(&reneg_lock);
+    }
+
+    void STUSB4500::begin_renegotiation()
+    {
+        uint32_t now = now_us();
+        uint32_t rdo_before = get_volatile_regs().rdo; // copie publiée, sans verrou
+
+        taskENTER_CRITICAL(&reneg_lock);
+        if (!reneg.pdo_written)
+            reneg.start_us = now;
+        else
+            reneg_phases[PdoToReset].add(now - reneg.start_us);
+        reneg.pdo_written = false;
+        reneg.reset_us = now;
+        reneg.alert_us = 0;
+        reneg.alert_seen = false;
+        reneg.rdo_before = rdo_before;
+        reneg_started++;
+        taskEXIT_CRITICAL(&reneg_lock);
+
+        reneg_pending.store(true, std::memory_order_release);
+
+        // La tâche de synchronisation raccourcit son attente tant que la mesure est ouverte
+        TaskHandle_t task = notify_task;
+        if (task)
+            xTaskNotify(task, command_bits, eSetBits);
+    }
+
+    void STUSB4500::track_renegotiation(const VolatileRegs &regs, bool ps_ready)
+    {
+        if (!reneg_pending.load(std::memory_order_acquire))
+            return;
+
+        uint32_t now = now_us();
+        bool done = false;
+
+        taskENTER_CRITICAL(&reneg_lock);
+        if (!reneg.alert_seen)
+        {
+            // Front ALERT horodaté par l'ISR, sinon premier état d'alerte lu
+            uint32_t stamp = alert_stamp_us.load(std::memory_order_relaxed);
+            if (alert_enabled && static_cast<int32_t>(stamp - reneg.reset_us) >= 0)
+                reneg.alert_us = stamp;
+            else if (regs.alert_status || regs.rdo != reneg.rdo_before)
+                reneg.alert_us = now;
+            reneg.alert_seen = reneg.alert_us != 0;
+        }
+
+        // Nouveau RDO, ou PS_RDY : la source a accepté une demande identique à la précédente
+        bool changed = regs.rdo != reneg.rdo_before;
+        if (changed || ps_ready)
+        {
+            if (!changed)
+                reneg_same_contract++;
+            reneg_phases[ResetToAlert].add(reneg.alert_us - reneg.reset_us);
+            reneg_phases[AlertToRdo].add(now - reneg.alert_us);
+            reneg_phases[Total].add(now - reneg.start_us);
+            done = true;
+        }
+        else if (now - reneg.reset_us >= RenegTimeoutUs)
+        {
+            reneg_timeouts++;
+            done = true;
+        }
+        taskEXIT_CRITICAL(&reneg_lock);
+
+        if (done)
+            reneg_pending.store(false, std::memory_order_release);
+    }
+
+    RenegotiationStats STUSB4500::get_renegotiation_stats() const
+    {
+        LatencyRecorder<RenegSamples> phases[4];
+        RenegotiationStats stats;
+
+        taskENTER_CRITICAL(&reneg_lock);
+        for (int i = 0; i < 4; ++i)
+            phases[i] = reneg_phases[i];
+        stats.started = reneg_started;
+        stats.same_contract = reneg_same_contract;
+        stats.timeouts = reneg_timeouts;
+        taskEXIT_CRITICAL(&reneg_lock);
+
+        // Tri des échantillons hors section critique
+        stats.pdo_to_reset = phases[PdoToReset].summarize();
+        stats.reset_to_alert = phases[ResetToAlert].summarize();
+        stats.alert_to_rdo = phases[AlertToRdo].summarize();
+        stats.total = phases[Total].summarize();
+        return stats;
+    }
+
+    void STUSB4500::reset_renegotiation_stats()
+    {
+        taskENTER_CRITICAL(&reneg_lock);
+        for (auto &phase : reneg_phases)
+            phase.reset();
+        reneg_started = 0;
+        reneg_same_contract = 0;
+        reneg_timeouts = 0;
+        taskEXIT_CRITICAL(&reneg_lock);
+    }
+}
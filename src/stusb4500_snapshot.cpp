@@ -0,0 +1,92 @@
+#include "stusb4500_internal.hpp"
+#include <cstring>
+#include <esp_timer.h>
+
+namespace stusb4500
+{
+    void STUSB4500::publish_snapshot()
+    {
+        // pdos, sector, volatile_regs et source_caps ne sont modifiés que sous le
+        // verrou d'état : la copie ne peut pas mêler deux états
+        StateLock lock(*this);
+
+        // Un seul écrivain à la fois ; les lecteurs ne prennent jamais ce verrou
+        taskENTER_CRITICAL(&publish_lock);
+
+        uint8_t next = published_slot.load(std::memory_order_relaxed) ^ 1;
+        SnapshotSlot &slot = snapshots[next];
+
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        Snapshot &snap = slot.data;
+        snap.generation = generation.load(std::memory_order_relaxed) + 1;
+        snap.timestamp_us = esp_timer_get_time();
+        snap.available = available;
+        memcpy(snap.pdos, pdos, sizeof(snap.pdos));
+        for (int i = 0; i < 3; ++i)
+        {
+            const SinkPdo active = SinkPdo::decode(volatile_regs.pdo[i]);
+            snap.active_pdos[i] = PDO{active.voltage, active.current};
+        }
+        memcpy(snap.sector, sector, sizeof(snap.sector));
+        snap.regs = volatile_regs;
+        snap.source = source_caps;
+
+        slot.seq.store(seq + 2, std::memory_order_release);
+        published_slot.store(next, std::memory_order_release);
+        generation.store(snap.generation, std::memory_order_release);
+
+        taskEXIT_CRITICAL(&publish_lock);
+
+        // Réveille les tâches en attente d'une nouvelle génération
+        if (snapshot_events)
+        {
+            xEventGroupSetBits(snapshot_events, SnapshotPublishedBit);
+            xEventGroupClearBits(snapshot_events, SnapshotPublishedBit);
+        }
+    }
+
+    Snapshot STUSB4500::get_snapshot() const
+    {
+        Snapshot out;
+        while (true)
+        {
+            const SnapshotSlot &slot = snapshots[published_slot.load(std::memory_order_acquire)];
+
+            uint32_t before = slot.seq.load(std::memory_order_acquire);
+            if (before & 1)
+                continue; // écriture en cours dans ce tampon
+
+            memcpy(&out, &slot.data, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.seq.load(std::memory_order_relaxed) == before)
+                return out;
+        }
+    }
+
+    bool STUSB4500::wait_for_generation(uint32_t after, Snapshot &out, TickType_t timeout)
+    {
+        TickType_t start = xTaskGetTickCount();
+
+        while (true)
+        {
+            out = get_snapshot();
+            if (out.generation > after)
+                return true;
+
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && elapsed >= timeout)
+                return false;
+
+            // Attente par tranches : une publication entre la lecture et l'attente
+            // ne peut retarder le réveil que d'une tranche
+            TickType_t slice = SnapshotWaitSlice;
+            if (timeout != portMAX_DELAY && timeout - elapsed < slice)
+                slice = timeout - elapsed;
+            xEventGroupWaitBits(snapshot_events, SnapshotPublishedBit, pdFALSE, pdFALSE, slice);
+        }
+    }
+}
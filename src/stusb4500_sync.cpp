@@ -1,9 +1,33 @@
 #include "stusb4500_internal.hpp"
 #include "stusb4500_conf.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <esp_check.h>
+#include <esp_timer.h>
 #include "driver/gpio.h"
 
+namespace
+{
+    using namespace stusb4500;
+
+    ContractRecord contract_record(const VolatileRegs &regs)
+    {
+        ContractRecord rec;
+        rec.timestamp_us = esp_timer_get_time();
+        rec.alert_status = regs.alert_status;
+        rec.attached = regs.port_status[1] & PortStatusAttach;
+        rec.object_position = rdo_object_position(regs.rdo);
+        rec.operating_ma = rdo_operating_ma(regs.rdo);
+        rec.max_ma = rdo_max_ma(regs.rdo);
+        rec.pdo_numb = regs.pdo_numb;
+        for (int i = 0; i < 3; ++i)
+            rec.pdo[i] = regs.pdo[i];
+        rec.rdo = regs.rdo;
+        return rec;
+    }
+}
+
 namespace stusb4500
 {
     void STUSB4500::start_sync_task()
@@ -16,25 +40,43 @@ namespace stusb4500
             5,
             &sync_task_handle,
             APP_CPU_NUM);
+        set_notifier(sync_task_handle, NotifyAlert, NotifyCommand);
+    }
+
+    void STUSB4500::set_notifier(TaskHandle_t task, uint32_t alert_bits, uint32_t wake_bits)
+    {
+        notify_bits = alert_bits;
+        command_bits = wake_bits;
+        notify_task = task;
     }
 
     void IRAM_ATTR STUSB4500::alert_isr_handler(void *arg)
     {
         auto *self = static_cast<STUSB4500 *>(arg);
-        self->alert_triggered = true;
+        self->alert_stamp_us.store(static_cast<uint32_t>(esp_timer_get_time()), std::memory_order_relaxed);
+
+        TaskHandle_t task = self->notify_task;
+        if (!task)
+            return;
+
+        // Réveil direct de la tâche de synchronisation (propre ou gestionnaire)
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(task, self->notify_bits, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
     }
 
     esp_err_t STUSB4500::configure_alert_pin(gpio_num_t gpio)
     {
+        STUSB_PROFILE_SCOPE(ConfigureAlertPin);
         alert_gpio = gpio;
-        alert_triggered = false;
 
+        // Front descendant : ALERT reste bas tant que ALERT_STATUS_1 n'est pas lu
         gpio_config_t io_conf = {
             .pin_bit_mask = 1ULL << gpio,
             .mode = GPIO_MODE_INPUT,
             .pull_up_en = GPIO_PULLUP_ENABLE,
             .pull_down_en = GPIO_PULLDOWN_DISABLE,
-            .intr_type = GPIO_INTR_LOW_LEVEL};
+            .intr_type = GPIO_INTR_NEGEDGE};
         ESP_RETURN_ON_ERROR(gpio_config(&io_conf), "STUSB4500", "GPIO config failed");
 
         // Installer service d’interruption si nécessaire
@@ -45,69 +87,349 @@ namespace stusb4500
             isr_service_installed = true;
         }
 
-        gpio_isr_handler_add(gpio, &STUSB4500::alert_isr_handler, this);
+        ESP_RETURN_ON_ERROR(gpio_isr_handler_add(gpio, &STUSB4500::alert_isr_handler, this), "STUSB4500", "ISR add failed");
         alert_enabled = true;
+
+        // Si la puce est déjà là, on démasque les alertes tout de suite
+        if (available)
+            arm_alerts();
         return ESP_OK;
     }
 
+    esp_err_t STUSB4500::arm_alerts()
+    {
+        uint8_t mask = AlertMask;
+        ESP_RETURN_ON_ERROR(write(ALERT_STATUS_1_MASK, &mask, 1), "STUSB4500", "Alert mask failed");
+
+        // Lecture ALERT_STATUS_1 .. PORT_STATUS_1 : efface les alertes en attente
+        uint8_t status[4];
+        return read(ALERT_STATUS_1, status, sizeof(status));
+    }
+
+    TickType_t STUSB4500::next_wait(uint32_t now) const
+    {
+        if (!available)
+        {
+            TickType_t ticks = pdMS_TO_TICKS(probe_interval_ms);
+            return ticks > 0 ? ticks : 1;
+        }
+        if (reneg_pending.load(std::memory_order_acquire))
+        {
+            // Renégociation en cours : scrutation rapide, ou réveil à l'échéance si ALERT la signale
+            TickType_t ticks = pdMS_TO_TICKS(alert_enabled ? RenegTimeoutUs / 1000 : RenegPollMs);
+            return ticks > 0 ? ticks : 1;
+        }
+        if (!alert_enabled)
+            return pdMS_TO_TICKS(100); // pas d'ALERT : scrutation de présence
+
+        // Avec ALERT : on ne se réveille que pour la resynchronisation périodique
+        uint32_t elapsed = now - last_sync_ms;
+        if (elapsed >= sync_interval_ms)
+            return 1;
+        TickType_t ticks = pdMS_TO_TICKS(sync_interval_ms - elapsed);
+        return ticks > 0 ? ticks : 1;
+    }
+
     void STUSB4500::sync_task(void *arg)
     {
         auto *self = static_cast<STUSB4500 *>(arg);
+        uint32_t events = 0;
 
         while (true)
         {
-            uint32_t now = esp_log_timestamp();
-            TickType_t delay = pdMS_TO_TICKS(self->available ? 100 : 10000);
+            TickType_t wait = self->service(events);
+
+            // Bloqué jusqu'à une alerte ou la prochaine échéance
+            if (xTaskNotifyWait(0, UINT32_MAX, &events, wait) != pdTRUE)
+                events = 0;
+        }
+    }
+
+    TickType_t STUSB4500::run_once(bool alert)
+    {
+        polled.store(true, std::memory_order_release);
+
+        // Pas de notification sans tâche : la file est consultée directement
+        uint32_t events = alert ? NotifyAlert : 0;
+        xSemaphoreTakeRecursive(command_mutex, portMAX_DELAY);
+        if (command_count > 0)
+            events |= NotifyCommand;
+        xSemaphoreGiveRecursive(command_mutex);
+        return service(events);
+    }
 
-            uint8_t buf;
-            esp_err_t ping = self->read(DPM_PDO_NUMB, &buf, 1);
-            bool is_online = (ping == ESP_OK);
+    TickType_t STUSB4500::service(uint32_t events)
+    {
+        STUSB_PROFILE_SCOPE(SyncTask);
+        uint32_t now = esp_log_timestamp();
 
-            if (is_online && !self->available)
+        // Alerte : attache, détache ou renégociation ont pu modifier les registres
+        if (events & NotifyAlert)
+            invalidate_shadow();
+
+        uint8_t buf;
+        esp_err_t ping = read(DPM_PDO_NUMB, &buf, 1);
+        bool is_online = (ping == ESP_OK);
+
+        if (!is_online && !available)
+        {
+            // Absente : recul exponentiel, relancé au rythme initial par un front ALERT
+            detect_stats.probes++;
+            if (probe_interval_ms == 0 || ((events & NotifyAlert) && detect_config.alert_trigger))
+                probe_interval_ms = detect_config.initial_ms;
+            else
+                probe_interval_ms = std::min(probe_interval_ms * 2, detect_config.max_ms);
+        }
+        else if (is_online && !available)
+        {
+            int64_t detected_us = esp_timer_get_time();
+            esp_err_t err;
             {
-                self->available = true;
-                self->read_sectors();
+                // Pas de séquence NVM applicative pendant la synchronisation initiale
+                SequenceGuard guard(*this);
+                invalidate_shadow();
 
-                if (!compare_sector(self->sector, default_sector_config))
+                // NVM puis registres volatiles ; les instantanés intermédiaires restent
+                // marqués indisponibles, l'état publié est complet dès available = true
+                err = read_sectors();
+                if (err == ESP_OK && alert_enabled)
+                    err = arm_alerts();
+                if (err == ESP_OK)
+                    err = sync_from_device();
+
+                if (err == ESP_OK)
                 {
-                    ESP_LOGW("STUSB4500", "Configuration NVM différente, mise à jour...");
-                    self->write_default_sectors(default_sector_config);
+                    StateLock lock(*this);
+                    available = true;
+                    publish_snapshot();
                 }
+            }
 
-                // Ensuite lecture des registres volatiles (PDOs)
-                self->sync_from_device();
-
-                self->last_sync_ms = now;
+            if (err != ESP_OK)
+            {
+                // Puce présente mais état incomplet : pas de ReadyBit, le recul continue
+                detect_stats.attach_failures++;
+                probe_interval_ms = probe_interval_ms == 0
+                                        ? detect_config.initial_ms
+                                        : std::min(probe_interval_ms * 2, detect_config.max_ms);
+                ESP_LOGW("STUSB4500", "Synchronisation initiale en échec : %s", esp_err_to_name(err));
+            }
+            else
+            {
+                probe_interval_ms = 0;
+                detect_stats.attaches++;
+                last_sync_ms = now;
+                events &= ~NotifyAlert; // synchronisation déjà faite, les commandes restent dues
+                mark_ready(detected_us);
                 ESP_LOGI("STUSB4500", "STUSB4500 détecté, synchronisation initiale effectuée.");
+
+                Event attached{EventType::Attached, esp_timer_get_time(), {}, contract_record(get_volatile_regs())};
+                publish_event(attached);
+                published_state = attached.after;
+                check_nvm_drift(); // avant la reprogrammation éventuelle
+
+                // Reprogrammation éventuelle après publication : l'application n'attend pas l'effacement
+                if (!compare_sector(get_snapshot().sector, default_sector_config))
+                {
+                    uint8_t programmed = 0;
+                    ESP_LOGW("STUSB4500", "Configuration NVM différente, mise à jour...");
+                    write_sectors_diff(default_sector_config, &programmed);
+                    ESP_LOGI("STUSB4500", "Secteurs reprogrammés : 0x%02X", programmed);
+                }
             }
-            else if (!is_online && self->available)
+        }
+        else if (!is_online && available)
+        {
             {
-                self->available = false;
-                ESP_LOGD("STUSB4500", "STUSB4500 non détecté (hors tension ?)");
+                SequenceGuard guard(*this);
+                StateLock lock(*this);
+                available = false;
+                xEventGroupClearBits(snapshot_events, ReadyBit);
+                nvm_image_valid = false; // la puce a pu être remplacée
+                invalidate_shadow();
+                probe_interval_ms = 0;   // rebranchement probable : sondage rapide
+                source_caps = SourceCapabilities{};
+                publish_snapshot();
             }
+            record_contract(VolatileRegs{}); // plus de contrat
+            ESP_LOGD("STUSB4500", "STUSB4500 non détecté (hors tension ?)");
+
+            Event detached{EventType::Detached, esp_timer_get_time(), published_state, {}};
+            publish_event(detached);
+            published_state = ContractRecord{};
+            published_drift = 0;
+        }
+
+        // Commandes asynchrones : exécutées ici, en série avec la synchronisation
+        if (events & NotifyCommand)
+            run_commands();
 
-            if (self->available)
+        if (available)
+        {
+            if (events & NotifyAlert)
             {
-                if (self->alert_enabled && self->alert_triggered)
-                {
-                    self->alert_triggered = false;
-                    self->sync_from_device();
-                    self->last_sync_ms = now;
-                }
-                else if ((now - self->last_sync_ms) >= self->sync_interval_ms)
-                {
-                    self->sync_from_device();
-                    self->last_sync_ms = now;
-                }
+                sync_from_device(); // la lecture d'état acquitte l'alerte
+                last_sync_ms = now;
+            }
+            else if ((now - last_sync_ms) >= sync_interval_ms)
+            {
+                sync_from_device();
+                last_sync_ms = now;
+            }
+            else if (reneg_pending.load(std::memory_order_acquire))
+            {
+                sync_volatile(); // attente du nouveau RDO
             }
+            publish_changes();
+        }
+
+        return next_wait(now);
+    }
+
+    void STUSB4500::mark_ready(int64_t detected_us)
+    {
+        int64_t ready_us = esp_timer_get_time();
+        if (detect_stats.time_to_first_sync_us == 0)
+            detect_stats.time_to_first_sync_us = static_cast<uint32_t>(ready_us - created_us);
+        detect_stats.last_ready_us = static_cast<uint32_t>(ready_us - detected_us);
+        xEventGroupSetBits(snapshot_events, ReadyBit);
+    }
 
-            vTaskDelay(delay);
+    esp_err_t STUSB4500::wait_until_ready(TickType_t timeout)
+    {
+        TickType_t start = xTaskGetTickCount();
+
+        while (true)
+        {
+            if (xEventGroupGetBits(snapshot_events) & ReadyBit)
+                return ESP_OK;
+
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && elapsed >= timeout)
+                return ESP_ERR_TIMEOUT;
+
+            TickType_t slice = SnapshotWaitSlice;
+            if (timeout != portMAX_DELAY && timeout - elapsed < slice)
+                slice = timeout - elapsed;
+            xEventGroupWaitBits(snapshot_events, ReadyBit, pdFALSE, pdFALSE, slice);
         }
     }
 
     esp_err_t STUSB4500::sync_from_device()
     {
-        return read(); // équivalent à read_sectors() + parsing dans pdos[] et sector[].
+        int64_t start = esp_timer_get_time();
+
+        esp_err_t err = sync_volatile();
+        if (err == ESP_OK && sync_mode == SyncMode::Nvm)
+            err = read(); // read_sectors() + parsing dans pdos[] et sector[]
+
+        if (err == ESP_OK)
+            record_contract(get_volatile_regs());
+
+        uint32_t elapsed = static_cast<uint32_t>(esp_timer_get_time() - start);
+        sync_stats.count++;
+        sync_stats.last_us = elapsed;
+        sync_stats.total_us += elapsed;
+        if (elapsed > sync_stats.max_us)
+            sync_stats.max_us = elapsed;
+        if (err != ESP_OK)
+            sync_stats.errors++;
+        return err;
+    }
+
+    void STUSB4500::record_contract(const VolatileRegs &regs)
+    {
+        // Pas d'allocation : l'enregistrement est copié dans la file
+        telemetry.push(contract_record(regs));
+    }
+
+    void STUSB4500::publish_changes()
+    {
+        // Seuls les PDO et le RDO comptent : ALERT_STATUS change à chaque alerte
+        ContractRecord current = contract_record(get_volatile_regs());
+        bool pdo_changed = current.pdo_numb != published_state.pdo_numb ||
+                           memcmp(current.pdo, published_state.pdo, sizeof(current.pdo)) != 0;
+        bool contract_changed = current.rdo != published_state.rdo;
+
+        if (pdo_changed)
+        {
+            Event e{EventType::PdoChanged, current.timestamp_us, published_state, current};
+            publish_event(e);
+        }
+        if (contract_changed)
+        {
+            Event e{EventType::ContractChanged, current.timestamp_us, published_state, current};
+            publish_event(e);
+        }
+        published_state = current;
+        check_nvm_drift();
+    }
+
+    void STUSB4500::check_nvm_drift()
+    {
+        Event e{EventType::NvmDrift, esp_timer_get_time(), {}, published_state};
+        {
+            StateLock lock(*this); // image NVM copiée sans attendre une programmation
+            if (!nvm_image_valid)
+                return; // rien de neuf depuis la dernière lecture
+
+            e.nvm_drift = dirty_sector_mask(nvm_image, default_sector_config);
+            for (uint8_t i = 0; i < SectorCount; ++i)
+            {
+                if (!(e.nvm_drift & (1 << i)))
+                    continue;
+                memcpy(e.nvm_expected[i], default_sector_config[i], SectorSize);
+                memcpy(e.nvm_actual[i], nvm_image[i], SectorSize);
+            }
+        }
+
+        // Un événement par nouvel écart, pas à chaque synchronisation
+        if (e.nvm_drift && e.nvm_drift != published_drift)
+            publish_event(e);
+        published_drift = e.nvm_drift;
+    }
+
+    esp_err_t STUSB4500::sync_volatile()
+    {
+        STUSB_PROFILE_SCOPE(SyncVolatile);
+        // Pas de garde de séquence : lectures dans des locales, puis mise à jour
+        // sous le verrou d'état (une programmation NVM en cours ne bloque pas ALERT)
+        VolatileRegs regs;
+        SourceCapabilities caps;
+        bool ps_ready = false;
+        uint8_t buffer[16];
+
+        // ALERT_STATUS_1 .. PORT_STATUS_1 (0x0B-0x0E) : la lecture libère aussi la ligne ALERT
+        ESP_RETURN_ON_ERROR(read(ALERT_STATUS_1, buffer, 4), "STUSB4500", "Status read failed");
+        regs.alert_status = buffer[0];
+        regs.alert_mask = buffer[1];
+        regs.port_status[0] = buffer[2];
+        regs.port_status[1] = buffer[3];
+
+        // Message PD reçu : Source_Capabilities éventuel à capturer avant qu'il soit écrasé,
+        // ou PS_RDY qui clôt une renégociation
+        if (regs.alert_status & PRT_STATUS_AL)
+            capture_source_capabilities(caps, ps_ready);
+
+        ESP_RETURN_ON_ERROR(read(DPM_PDO_NUMB, &regs.pdo_numb, 1), "STUSB4500", "DPM_PDO_NUMB read failed");
+        regs.pdo_numb &= 0x07;
+
+        // DPM_SNK_PDO1..3 puis RDO_REG_STATUS (0x85-0x94) sont contigus
+        ESP_RETURN_ON_ERROR(read(DPM_SNK_PDO1, buffer, sizeof(buffer)), "STUSB4500", "PDO/RDO read failed");
+        for (int i = 0; i < 3; ++i)
+            regs.pdo[i] = le32(&buffer[i * 4]); // pdos[] garde les valeurs NVM
+        regs.rdo = le32(&buffer[12]);
+
+        track_renegotiation(regs, ps_ready);
+
+        StateLock lock(*this); // état volatil modifié et publié d'un seul tenant
+        if (!(regs.port_status[1] & PortStatusAttach))
+            source_caps = SourceCapabilities{};
+        else if (caps.count > 0)
+            source_caps = caps;
+        volatile_regs = regs;
+        publish_snapshot();
+        return ESP_OK;
     }
 
 } // namespace stusb4500
@@ -0,0 +1,197 @@
+#include "stusb4500_internal.hpp"
+#include "stusb4500_fields.hpp"
+#include <bit>
+#include <cstring>
+#include <esp_check.h>
+#include <esp_timer.h>
+
+namespace stusb4500
+{
+    ConfigTransaction STUSB4500::begin_config()
+    {
+        STUSB_PROFILE_SCOPE(BeginConfig);
+        return ConfigTransaction(*this);
+    }
+
+    ConfigTransaction::ConfigTransaction(STUSB4500 &dev)
+        : dev(dev)
+    {
+        dev.acquire_sequence();
+        if (!dev.available)
+        {
+            ESP_LOGW("STUSB4500", "%s: périphérique non disponible", __FUNCTION__);
+            status = ESP_ERR_INVALID_STATE;
+            return;
+        }
+
+        uint32_t tx = dev.bus_transactions.load(std::memory_order_relaxed);
+        int64_t start = esp_timer_get_time();
+
+        status = dev.read_sectors();
+        if (status == ESP_OK)
+            memcpy(image, dev.sector, sizeof(image));
+
+        read_us = static_cast<uint32_t>(esp_timer_get_time() - start);
+        read_transactions = dev.bus_transactions.load(std::memory_order_relaxed) - tx;
+    }
+
+    ConfigTransaction::~ConfigTransaction()
+    {
+        dev.release_sequence();
+    }
+
+    template <typename Field>
+    void ConfigTransaction::edit(int value)
+    {
+        if (status != ESP_OK)
+            return;
+
+        nvm::set<Field>(image, value);
+        dirty |= Field::sectors;
+        edits++;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_upper_voltage_limit(uint8_t pdo_numb, uint8_t value)
+    {
+        if (value < 5)
+            value = 5;
+        if (value > 20)
+            value = 20;
+
+        switch (pdo_numb)
+        {
+        case 1:
+            edit<nvm::Pdo1UpperLimit>(value);
+            break;
+        case 2:
+            edit<nvm::Pdo2UpperLimit>(value);
+            break;
+        case 3:
+            edit<nvm::Pdo3UpperLimit>(value);
+            break;
+        }
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_lower_voltage_limit(uint8_t pdo_numb, uint8_t value)
+    {
+        if (value < 5)
+            value = 5;
+        if (value > 20)
+            value = 20;
+
+        switch (pdo_numb)
+        {
+        case 2:
+            edit<nvm::Pdo2LowerLimit>(value);
+            break;
+        case 3:
+            edit<nvm::Pdo3LowerLimit>(value);
+            break;
+        }
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_flex_current(float value)
+    {
+        return set_flex_current(Milliamps::from_si(value));
+    }
+
+    ConfigTransaction &ConfigTransaction::set_flex_current(Milliamps value)
+    {
+        value = value.clamp(Milliamps(0), Milliamps(5000));
+
+        // Champ réparti sur sector[4][3] et sector[4][4] (pas de 10 mA)
+        edit<nvm::FlexCurrent>(static_cast<int>(value.value));
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_external_power(uint8_t value)
+    {
+        edit<nvm::ExternalPower>(value ? 1 : 0);
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_usb_comm_capable(uint8_t value)
+    {
+        edit<nvm::UsbCommCapable>(value ? 1 : 0);
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_config_ok_gpio(uint8_t value)
+    {
+        if (value < 2)
+            value = 0;
+        else if (value > 3)
+            value = 3;
+
+        edit<nvm::ConfigOkGpio>(value);
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_gpio_ctrl(uint8_t value)
+    {
+        if (value > 3)
+            value = 3;
+
+        edit<nvm::GpioCtrl>(value);
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_power_above_5v_only(uint8_t value)
+    {
+        edit<nvm::PowerAbove5vOnly>(value ? 1 : 0);
+        return *this;
+    }
+
+    ConfigTransaction &ConfigTransaction::set_req_src_current(uint8_t value)
+    {
+        edit<nvm::ReqSrcCurrent>(value ? 1 : 0);
+        return *this;
+    }
+
+    esp_err_t ConfigTransaction::commit(CommitReport *report)
+    {
+        STUSB_PROFILE_SCOPE(Commit);
+        ESP_RETURN_ON_ERROR(status, "STUSB4500", "Transaction invalide");
+
+        CommitReport r;
+        r.edits = edits;
+        r.transactions = read_transactions;
+        r.elapsed_us = read_us;
+
+        // Un champ réécrit à l'identique ne justifie pas d'effacer son secteur
+        dirty &= dirty_sector_mask(image, dev.nvm_image);
+
+        if (dirty)
+        {
+            // Même chemin que write_sectors_diff() : vérification et reprises éventuelles
+            ESP_RETURN_ON_ERROR(dev.program_sectors(image, dirty), "STUSB4500", "Program sectors failed");
+            {
+                StateLock lock(dev);
+                memcpy(dev.sector, image, sizeof(image));
+                STUSB4500::decode_pdos(dev.sector, dev.pdos);
+                dev.publish_snapshot();
+            }
+
+            const STUSB4500::ProgramPhases &p = dev.last_program;
+            r.sectors = static_cast<uint8_t>(std::popcount(dirty));
+            r.transactions += p.enter_tx + p.program_tx + p.exit_tx;
+            r.elapsed_us += p.enter_us + p.program_us + p.exit_us;
+
+            // Coût estimé d'une écriture par champ : lecture + effacement + un secteur + sortie
+            uint32_t per_edit_tx = read_transactions + p.enter_tx + p.program_tx / r.sectors + p.exit_tx;
+            uint32_t per_edit_us = read_us + p.enter_us + p.program_us / r.sectors + p.exit_us;
+            uint32_t unbatched_tx = per_edit_tx * edits;
+            uint32_t unbatched_us = per_edit_us * edits;
+            r.saved_transactions = unbatched_tx > r.transactions ? unbatched_tx - r.transactions : 0;
+            r.saved_us = unbatched_us > r.elapsed_us ? unbatched_us - r.elapsed_us : 0;
+        }
+
+        dirty = 0;
+        edits = 0;
+        if (report)
+            *report = r;
+        return ESP_OK;
+    }
+}